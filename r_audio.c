@@ -633,7 +633,8 @@ r_status_t r_audio_set_volume(r_state_t *rs, unsigned char volume)
         /* Check to see if the audio subsystem is already running */
         r_boolean_t audio_not_running = (rs->audio_volume <= 0) ? R_TRUE : R_FALSE;
 
-        if (volume > 0)
+        /* The audio device is never opened when headless (the volume stays at zero, so clips are never played) */
+        if (volume > 0 && !rs->headless)
         {
             /* Start the audio subsystem, if necessary */
             if (audio_not_running)
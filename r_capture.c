@@ -39,6 +39,12 @@ THE SOFTWARE.
 #define R_CAPTURE_FLUSH_SIZE    (4 * R_CAPTURE_PAGE_SIZE)
 #define R_CAPTURE_BUFFER_SIZE   (8 * R_CAPTURE_FLUSH_SIZE)
 
+/* Timestamps follow the simulated clock when headless (so that offscreen captures are reproducible) */
+R_INLINE unsigned int r_capture_get_ticks(r_state_t *rs)
+{
+    return rs->headless ? rs->headless_time_ms : SDL_GetTicks();
+}
+
 r_status_t r_capture_start(r_state_t *rs, r_capture_t **capture_out)
 {
     /* Find a new filename */
@@ -83,7 +89,7 @@ r_status_t r_capture_start(r_state_t *rs, r_capture_t **capture_out)
 
                 if (R_SUCCEEDED(status))
                 {
-                    r_capture_header_t video_log_header = { r_capture_signature, R_CAPTURE_TYPE_VIDEO, SDL_GetTicks(), {  { R_CAPTURE_VIDEO_CODEC_DIFF_RLE, rs->video_width, rs->video_height } } };
+                    r_capture_header_t video_log_header = { r_capture_signature, R_CAPTURE_TYPE_VIDEO, r_capture_get_ticks(rs), {  { R_CAPTURE_VIDEO_CODEC_DIFF_RLE, rs->video_width, rs->video_height } } };
 
                     status = r_stream_async_write(&capture->video_log, sizeof(r_capture_header_t), &video_log_header);
 
@@ -94,7 +100,7 @@ r_status_t r_capture_start(r_state_t *rs, r_capture_t **capture_out)
 
                         if (R_SUCCEEDED(status))
                         {
-                            r_capture_header_t audio_log_header = { r_capture_signature, R_CAPTURE_TYPE_AUDIO, SDL_GetTicks(), { { R_CAPTURE_AUDIO_CODEC_RAW } } };
+                            r_capture_header_t audio_log_header = { r_capture_signature, R_CAPTURE_TYPE_AUDIO, r_capture_get_ticks(rs), { { R_CAPTURE_AUDIO_CODEC_RAW } } };
 
                             status = r_stream_async_write(&capture->audio_log, sizeof(r_capture_header_t), &audio_log_header);
 
@@ -178,7 +184,7 @@ r_status_t r_capture_write_video_packet(r_state_t *rs, r_capture_t *capture)
 
         /* Read all pixels from the display (note: alpha is only read to ensure 4-byte alignment--it's later dropped) */
         glReadPixels(0, 0, rs->video_width, rs->video_height, GL_RGBA, GL_UNSIGNED_BYTE, capture->video_buffers[video_buffer_index_next]);
-        frame->ms = SDL_GetTicks();
+        frame->ms = r_capture_get_ticks(rs);
 
         /* Store the difference in the previous frame's buffer (ignoring the alpha channel and using the extra byte to represent negative values) */
         for (i = 0; i < pixel_count; ++i)
@@ -197,7 +203,7 @@ r_status_t r_capture_write_video_packet(r_state_t *rs, r_capture_t *capture)
 
 r_status_t r_capture_write_audio_packet(r_state_t *rs, r_capture_t *capture, unsigned int bytes, unsigned char *data)
 {
-    r_capture_audio_packet_t frame = { SDL_GetTicks(), bytes };
+    r_capture_audio_packet_t frame = { r_capture_get_ticks(rs), bytes };
     r_status_t status = r_stream_async_write(&capture->audio_log, sizeof(r_capture_audio_packet_t), &frame);
 
     if (R_SUCCEEDED(status))
@@ -29,6 +29,7 @@ THE SOFTWARE.
 #include "r_collision_detector.h"
 #include "r_mesh.h"
 #include "r_entity.h"
+#include "r_profiler.h"
 
 /* Two-dimensional triangle-triangle collision detection, adapted from http://www.acm.org/jgt/papers/GuigueDevillers03/ (2003) */
 
@@ -351,7 +352,9 @@ static int l_CollisionDetector_checkCollision(lua_State *ls)
         r_entity_t *e2 = (r_entity_t*)lua_touserdata(ls, 3);
         r_boolean_t intersect = R_FALSE;
 
+        r_profiler_push(rs, R_PROFILER_PHASE_COLLISION);
         status = r_collision_detector_intersect_entities(rs, e1, e2, &intersect);
+        r_profiler_pop(rs);
 
         if (R_SUCCEEDED(status))
         {
@@ -387,7 +390,9 @@ static r_status_t r_collision_detector_for_each_callback(r_state_t *rs, r_entity
 
         if (R_SUCCEEDED(status))
         {
+            r_profiler_push(rs, R_PROFILER_PHASE_SCRIPT);
             status = r_script_call(rs, 2, 0);
+            r_profiler_pop(rs);
         }
         else
         {
@@ -420,6 +425,7 @@ static int l_CollisionDetector_forEachCollision(lua_State *ls)
         r_collision_detector_t *collision_detector = (r_collision_detector_t*)lua_touserdata(ls, collision_detector_index);
 
         /* Need to lock the collision tree during iteration */
+        r_profiler_push(rs, R_PROFILER_PHASE_COLLISION);
         status = r_collision_detector_lock(rs, collision_detector);
 
         if (R_SUCCEEDED(status))
@@ -445,6 +451,8 @@ static int l_CollisionDetector_forEachCollision(lua_State *ls)
 
             r_collision_detector_unlock(rs, collision_detector);
         }
+
+        r_profiler_pop(rs);
     }
 
     lua_pop(ls, lua_gettop(ls));
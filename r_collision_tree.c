@@ -69,7 +69,7 @@ static r_status_t r_entity_to_node_free(r_state_t *rs, void *value)
     return R_SUCCESS;
 }
 
-r_hash_table_def_t r_entity_to_node_def = { sizeof(r_collision_tree_node_t*), 5, 0.75, r_entity_to_node_key_hash, r_entity_to_node_free };
+r_hash_table_def_t r_entity_to_node_def = { sizeof(r_collision_tree_node_t*), 5, 0.75, r_entity_to_node_key_hash, r_entity_to_node_free, NULL };
 
 static r_collision_tree_entry_t *r_collision_tree_entry_list_get_index(r_state_t *rs, const r_collision_tree_entry_list_t *list, unsigned int index)
 {
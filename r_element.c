@@ -21,18 +21,25 @@ THE SOFTWARE.
 */
 
 #include <lua.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "r_assert.h"
 #include "r_object_enum.h"
 #include "r_element.h"
 #include "r_script.h"
 #include "r_color.h"
+#include "r_string_buffer.h"
+#include "r_video.h"
 
 const char *r_element_type_names[R_ELEMENT_TYPE_MAX] = {
     "image",
     "imageRegion",
     "animation",
-    "text"
+    "text",
+    "particleEmitter",
+    "tilemap"
 };
 
 r_object_enum_t r_element_type_enum = { { R_OBJECT_REF_INVALID, { NULL } }, R_ELEMENT_TYPE_MAX, r_element_type_names };
@@ -53,6 +60,8 @@ r_object_field_t r_element_image_fields[] = {
     { "angle",  LUA_TNUMBER,   0,                   offsetof(r_element_image_t, element.angle),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "color",  LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_image_t, element.color),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "type",   LUA_TSTRING,   0,                   offsetof(r_element_image_t, element.element_type), R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_element_type_field_read, NULL, NULL },
+    { "set",    LUA_TFUNCTION, 0,                   0,                          R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_set, NULL },
+    { "get",    LUA_TFUNCTION, 0,                   0,                          R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
     { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
 };
 
@@ -99,6 +108,8 @@ r_object_field_t r_element_image_region_fields[] = {
     { "angle",  LUA_TNUMBER,   0,                   offsetof(r_element_image_region_t, image.element.angle),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "color",  LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_image_region_t, image.element.color),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "type",   LUA_TSTRING,   0,                   offsetof(r_element_image_region_t, image.element.element_type), R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_element_type_field_read, NULL, NULL },
+    { "set",    LUA_TFUNCTION, 0,                   0,                                 R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_set, NULL },
+    { "get",    LUA_TFUNCTION, 0,                   0,                                 R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
     { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
 };
 
@@ -133,6 +144,7 @@ static void r_animation_frame_null(r_state_t *rs, void *item)
 
     r_object_ref_init(&animation_frame->image);
     animation_frame->ms = 0;
+    animation_frame->end_ms = 0;
 }
 
 static void r_animation_frame_copy(r_state_t *rs, void *to, const void *from)
@@ -183,13 +195,14 @@ static r_status_t r_animation_init(r_state_t *rs, r_object_t *object)
 
     animation->loop = R_FALSE;
     animation->transient = R_FALSE;
+    animation->duration_ms = 0;
 
     return r_animation_frame_list_init(rs, &animation->frames);
 }
 
 static r_status_t r_animation_add_frame(r_state_t *rs, r_animation_t *animation, int image_name_index, r_real_t ms)
 {
-    r_animation_frame_t animation_frame = { { R_OBJECT_REF_INVALID, { NULL } }, 0 };
+    r_animation_frame_t animation_frame = { { R_OBJECT_REF_INVALID, { NULL } }, 0, 0 };
 
     /* Note: The animation takes ownership of the image, but the reference is stored in the frame */
     /* Also note that this function assume the type of image_name_index has already been checked */
@@ -197,15 +210,65 @@ static r_status_t r_animation_add_frame(r_state_t *rs, r_animation_t *animation,
 
     if (R_SUCCEEDED(status))
     {
+        /* Frames are only ever appended, so the cumulative time table can be maintained here */
         animation_frame.ms = ms;
+        animation_frame.end_ms = animation->duration_ms + ms;
 
         /* Now add to the list of frames */
         status = r_animation_frame_list_add(rs, &animation->frames, &animation_frame);
+
+        if (R_SUCCEEDED(status))
+        {
+            animation->duration_ms = animation_frame.end_ms;
+        }
     }
 
     return status;
 }
 
+unsigned int r_animation_get_frame_index(r_state_t *rs, const r_animation_t *animation, r_real_t elapsed_ms)
+{
+    unsigned int index = 0;
+
+    if (animation->frames.count > 0)
+    {
+        if (animation->loop && animation->duration_ms > 0)
+        {
+            elapsed_ms = (r_real_t)fmod(elapsed_ms, animation->duration_ms);
+        }
+
+        if (elapsed_ms >= animation->duration_ms)
+        {
+            /* Finished; show the last frame */
+            index = animation->frames.count - 1;
+        }
+        else
+        {
+            /* Binary search for the first frame ending after the elapsed time */
+            unsigned int low = 0;
+            unsigned int high = animation->frames.count - 1;
+
+            while (low < high)
+            {
+                const unsigned int middle = (low + high) / 2;
+
+                if (r_animation_frame_list_get_index(rs, &animation->frames, middle)->end_ms > elapsed_ms)
+                {
+                    high = middle;
+                }
+                else
+                {
+                    low = middle + 1;
+                }
+            }
+
+            index = low;
+        }
+    }
+
+    return index;
+}
+
 static r_status_t r_animation_process_arguments(r_state_t *rs, r_object_t *object, int argument_count)
 {
     lua_State *ls = rs->script_state;
@@ -303,8 +366,33 @@ static int l_Animation_addFrame(lua_State *ls)
 /* Animation elements (these actually display an animation) */
 r_object_ref_t r_element_animation_reset = { R_OBJECT_REF_INVALID, { NULL } };
 
+static r_status_t r_element_animation_activity_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
+{
+    /* Whether or not the element needs updates may have changed */
+    r_status_t status = r_object_field_write_default(rs, object, field, value, value_index);
+
+    if (R_SUCCEEDED(status))
+    {
+        /* Synchronized looping animations share a phase; others start from when they were set up (otherwise
+         * non-looping animations created mid-game would already be finished) */
+        r_element_animation_t *element_animation = (r_element_animation_t*)object;
+        const r_animation_t *animation = (const r_animation_t*)element_animation->element.image.value.object;
+
+        element_animation->start_ms = (animation != NULL && animation->loop) ? 0 : rs->animation_clock_ms;
+
+        /* Elements don't know which entities hold them, so if the element now needs updates, all entities' cached
+         * activity is invalidated */
+        if (!element_animation->synchronized || (animation != NULL && animation->transient))
+        {
+            rs->entity_activity_version = rs->entity_activity_version + 1;
+        }
+    }
+
+    return status;
+}
+
 r_object_field_t r_element_animation_fields[] = {
-    { "animation", LUA_TUSERDATA, R_OBJECT_TYPE_ANIMATION, offsetof(r_element_animation_t, element.image), R_TRUE,  R_OBJECT_INIT_REQUIRED, NULL, NULL, NULL, NULL },
+    { "animation", LUA_TUSERDATA, R_OBJECT_TYPE_ANIMATION, offsetof(r_element_animation_t, element.image), R_TRUE,  R_OBJECT_INIT_REQUIRED, NULL, NULL, NULL, r_element_animation_activity_field_write },
     { "x",      LUA_TNUMBER,   0,                   offsetof(r_element_animation_t, element.x),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "y",      LUA_TNUMBER,   0,                   offsetof(r_element_animation_t, element.y),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "z",      LUA_TNUMBER,   0,                   offsetof(r_element_animation_t, element.z),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
@@ -313,7 +401,10 @@ r_object_field_t r_element_animation_fields[] = {
     { "angle",  LUA_TNUMBER,   0,                   offsetof(r_element_animation_t, element.angle),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "color",  LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_animation_t, element.color),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "type",   LUA_TSTRING,   0,                   offsetof(r_element_animation_t, element.element_type), R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_element_type_field_read, NULL, NULL },
+    { "synchronized", LUA_TBOOLEAN, 0,              offsetof(r_element_animation_t, synchronized),         R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, r_element_animation_activity_field_write },
     { "reset",  LUA_TFUNCTION, 0,                   0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_element_animation_reset, NULL },
+    { "set",    LUA_TFUNCTION, 0,                   0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_set, NULL },
+    { "get",    LUA_TFUNCTION, 0,                   0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
     { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
 };
 
@@ -334,8 +425,9 @@ static r_status_t r_element_animation_init(r_state_t *rs, r_object_t *object)
     element_animation->element.color.ref            = R_OBJECT_REF_INVALID;
     element_animation->element.color.value.object   = (r_object_t*)(&r_color_white);
 
-    element_animation->frame_index = 0;
-    element_animation->frame_ms = 0;
+    element_animation->synchronized = R_FALSE;
+    element_animation->start_ms = rs->animation_clock_ms;
+    element_animation->elapsed_ms = 0;
 
     return R_SUCCESS;
 }
@@ -347,6 +439,27 @@ static int l_Element_Animation_new(lua_State *ls)
     return l_Object_new(ls, &r_element_animation_header);
 }
 
+r_real_t r_element_animation_get_elapsed_ms(r_state_t *rs, const r_element_animation_t *element_animation)
+{
+    r_real_t elapsed_ms = element_animation->elapsed_ms;
+
+    if (element_animation->synchronized)
+    {
+        /* Wrap looping animations before converting to a real number (which can't represent large times exactly) */
+        const r_animation_t *animation = (const r_animation_t*)element_animation->element.image.value.object;
+        double shared_elapsed_ms = (double)(rs->animation_clock_ms - element_animation->start_ms);
+
+        if (animation != NULL && animation->loop && animation->duration_ms > 0)
+        {
+            shared_elapsed_ms = fmod(shared_elapsed_ms, (double)animation->duration_ms);
+        }
+
+        elapsed_ms = (r_real_t)shared_elapsed_ms;
+    }
+
+    return elapsed_ms;
+}
+
 static int l_Element_Animation_reset(lua_State *ls)
 {
     const r_script_argument_t expected_arguments[] = {
@@ -367,8 +480,8 @@ static int l_Element_Animation_reset(lua_State *ls)
             /* Reset the animation */
             r_element_animation_t *element_animation = (r_element_animation_t*)element;
 
-            element_animation->frame_index = 0;
-            element_animation->frame_ms = 0;
+            element_animation->start_ms = rs->animation_clock_ms;
+            element_animation->elapsed_ms = 0;
         }
     }
 
@@ -392,12 +505,32 @@ r_status_t r_element_text_alignment_field_read(r_state_t *rs, r_object_t *object
 
 r_status_t r_element_text_alignment_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
 {
-    return r_object_enum_field_write(rs, value, value_index, &r_element_text_alignment_enum);
+    r_status_t status = r_object_enum_field_write(rs, value, value_index, &r_element_text_alignment_enum);
+
+    if (R_SUCCEEDED(status))
+    {
+        ((r_element_text_t*)object)->glyphs_dirty = R_TRUE;
+    }
+
+    return status;
+}
+
+static r_status_t r_element_text_glyphs_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
+{
+    /* Glyph positions depend on the text, so they must be rebuilt */
+    r_status_t status = r_object_field_write_default(rs, object, field, value, value_index);
+
+    if (R_SUCCEEDED(status))
+    {
+        ((r_element_text_t*)object)->glyphs_dirty = R_TRUE;
+    }
+
+    return status;
 }
 
 /* Text elements */
 r_object_field_t r_element_text_fields[] = {
-    { "text",            LUA_TSTRING,   0,                           offsetof(r_element_text_t, text),                 R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "text",            LUA_TSTRING,   0,                           offsetof(r_element_text_t, text),                 R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, r_element_text_glyphs_field_write },
     { "x",               LUA_TNUMBER,   0,                           offsetof(r_element_text_t, element.x),            R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "y",               LUA_TNUMBER,   0,                           offsetof(r_element_text_t, element.y),            R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "z",               LUA_TNUMBER,   0,                           offsetof(r_element_text_t, element.z),            R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
@@ -407,8 +540,10 @@ r_object_field_t r_element_text_fields[] = {
     { "color",           LUA_TUSERDATA, R_OBJECT_TYPE_COLOR,         offsetof(r_element_text_t, element.color),        R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
     { "alignment",       LUA_TSTRING,   0,                           offsetof(r_element_text_t, alignment),            R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, r_element_text_alignment_field_read, NULL, r_element_text_alignment_field_write },
     { "font",            LUA_TSTRING,   0,                           offsetof(r_element_text_t, element.image),        R_TRUE, R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_image_read,           NULL, r_object_field_image_write },
-    { "buffer",          LUA_TUSERDATA, R_OBJECT_TYPE_STRING_BUFFER, offsetof(r_element_text_t, buffer),               R_TRUE, R_OBJECT_INIT_EXCLUDED, NULL, NULL, NULL, NULL },
+    { "buffer",          LUA_TUSERDATA, R_OBJECT_TYPE_STRING_BUFFER, offsetof(r_element_text_t, buffer),               R_TRUE, R_OBJECT_INIT_EXCLUDED, NULL, NULL, NULL, r_element_text_glyphs_field_write },
     { "type",            LUA_TSTRING,   0,                           offsetof(r_element_text_t, element.element_type), R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_element_type_field_read, NULL, NULL },
+    { "set",             LUA_TFUNCTION, 0,                           0,                         R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_set, NULL },
+    { "get",             LUA_TFUNCTION, 0,                           0,                         R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
     { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
 };
 
@@ -438,16 +573,847 @@ static r_status_t r_element_text_init(r_state_t *rs, r_object_t *object)
     element_text->buffer.ref                    = R_OBJECT_REF_INVALID;
     element_text->buffer.value.object           = NULL;
 
+    element_text->glyphs_dirty                  = R_TRUE;
+    element_text->glyphs_version                = 0;
+    element_text->glyph_count                   = 0;
+    element_text->glyphs_allocated              = 0;
+    element_text->glyphs                        = NULL;
+
     return R_SUCCESS;
 }
 
-r_object_header_t r_element_text_header = { R_OBJECT_TYPE_ELEMENT, sizeof(r_element_text_t), R_FALSE, r_element_text_fields, r_element_text_init, NULL, NULL };
+static r_status_t r_element_text_cleanup(r_state_t *rs, r_object_t *object)
+{
+    r_element_text_t *element_text = (r_element_text_t*)object;
+
+    if (element_text->glyphs != NULL)
+    {
+        free(element_text->glyphs);
+        element_text->glyphs = NULL;
+    }
+
+    element_text->glyph_count = 0;
+    element_text->glyphs_allocated = 0;
+
+    return R_SUCCESS;
+}
+
+r_object_header_t r_element_text_header = { R_OBJECT_TYPE_ELEMENT, sizeof(r_element_text_t), R_FALSE, r_element_text_fields, r_element_text_init, NULL, r_element_text_cleanup };
+
+r_status_t r_element_text_glyphs_build(r_state_t *rs, r_element_text_t *element_text)
+{
+    r_status_t status = (element_text != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        const char *pc = NULL;
+        unsigned int length = 0;
+        unsigned int version = 0;
+
+        /* If text is provided, use it; otherwise check for an underlying string buffer */
+        if (element_text->text.value.str != NULL)
+        {
+            pc = element_text->text.value.str;
+        }
+        else if (element_text->buffer.value.object != NULL && element_text->buffer.value.object->header->type == R_OBJECT_TYPE_STRING_BUFFER)
+        {
+            r_string_buffer_t *string_buffer = (r_string_buffer_t*)element_text->buffer.value.object;
+
+            if (string_buffer->buffer != NULL)
+            {
+                pc = string_buffer->buffer;
+                length = (unsigned int)string_buffer->length;
+                version = string_buffer->version;
+            }
+        }
+
+        if (element_text->glyphs_dirty || element_text->glyphs_version != version)
+        {
+            /* Determine length (string buffers track their own length) */
+            if (pc != NULL && length == 0)
+            {
+                length = (unsigned int)strlen(pc);
+            }
+
+            if (length > element_text->glyphs_allocated)
+            {
+                r_glyph_t *glyphs = (r_glyph_t*)realloc(element_text->glyphs, length * sizeof(r_glyph_t));
+
+                status = (glyphs != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+                if (R_SUCCEEDED(status))
+                {
+                    element_text->glyphs = glyphs;
+                    element_text->glyphs_allocated = length;
+                }
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                r_real_t x = 0;
+                unsigned int i;
+
+                /* Adjust position for alignment */
+                switch (element_text->alignment)
+                {
+                case R_ELEMENT_TEXT_ALIGNMENT_LEFT:
+                    /* No adjustment needed for left alignment */
+                    break;
+
+                case R_ELEMENT_TEXT_ALIGNMENT_CENTER:
+                    x = -((r_real_t)length) / 2;
+                    break;
+
+                case R_ELEMENT_TEXT_ALIGNMENT_RIGHT:
+                    x = -((r_real_t)length);
+                    break;
+
+                default:
+                    R_ASSERT(0);
+                    status = R_F_INVALID_INDEX;
+                    break;
+                }
+
+                for (i = 0; i < length && R_SUCCEEDED(status); ++i, x += 1)
+                {
+                    /* Characters in a font are stored in a 12x8 table */
+                    const r_font_coordinates_t *fc = &r_font_coordinates[(unsigned char)pc[i]];
+                    r_glyph_t *glyph = &element_text->glyphs[i];
+
+                    glyph->x = x;
+                    glyph->u1 = fc->x_min;
+                    glyph->v1 = fc->y_min;
+                    glyph->u2 = fc->x_max;
+                    glyph->v2 = fc->y_max;
+                }
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                element_text->glyph_count = length;
+                element_text->glyphs_version = version;
+                element_text->glyphs_dirty = R_FALSE;
+            }
+        }
+    }
+
+    return status;
+}
 
 static int l_Element_Text_new(lua_State *ls)
 {
     return l_Object_new(ls, &r_element_text_header);
 }
 
+/* Particle emitter elements */
+r_object_ref_t r_element_particle_emitter_ref_emit  = { R_OBJECT_REF_INVALID, { NULL } };
+r_object_ref_t r_element_particle_emitter_ref_clear = { R_OBJECT_REF_INVALID, { NULL } };
+
+r_object_field_t r_element_particle_emitter_fields[] = {
+    { "image",      LUA_TSTRING,   0,                   offsetof(r_element_particle_emitter_t, element.image),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_image_read, NULL, r_object_field_image_write },
+    { "x",          LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, element.x),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "y",          LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, element.y),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "z",          LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, element.z),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "width",      LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, element.width),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "height",     LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, element.height),       R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "angle",      LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, element.angle),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "color",      LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_particle_emitter_t, element.color),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "emitting",   LUA_TBOOLEAN,  0,                   offsetof(r_element_particle_emitter_t, emitting),             R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "rate",       LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, rate),                 R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "life",       LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, life),                 R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "speed",      LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, speed),                R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "spread",     LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, spread),               R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "gravityX",   LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, gravity_x),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "gravityY",   LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, gravity_y),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "frames",     LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, frames),               R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "maximum",    LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, maximum),              R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "startColor", LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_particle_emitter_t, start_color),          R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "endColor",   LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_particle_emitter_t, end_color),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "count",      LUA_TNUMBER,   0,                   offsetof(r_element_particle_emitter_t, count),                R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_field_read_unsigned_int, NULL, NULL },
+    { "type",       LUA_TSTRING,   0,                   offsetof(r_element_particle_emitter_t, element.element_type), R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_element_type_field_read, NULL, NULL },
+    { "emit",       LUA_TFUNCTION, 0,                   0,                                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_element_particle_emitter_ref_emit, NULL },
+    { "clear",      LUA_TFUNCTION, 0,                   0,                                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_element_particle_emitter_ref_clear, NULL },
+    { "set",        LUA_TFUNCTION, 0,                   0,                                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_set, NULL },
+    { "get",        LUA_TFUNCTION, 0,                   0,                                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
+    { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
+};
+
+static r_status_t r_element_particle_emitter_init(r_state_t *rs, r_object_t *object)
+{
+    r_element_particle_emitter_t *element_particle_emitter = (r_element_particle_emitter_t*)object;
+
+    element_particle_emitter->element.element_type = R_ELEMENT_TYPE_PARTICLE_EMITTER;
+
+    element_particle_emitter->element.x         = 0;
+    element_particle_emitter->element.y         = 0;
+    element_particle_emitter->element.z         = 0;
+    element_particle_emitter->element.width     = 1;
+    element_particle_emitter->element.height    = 1;
+    element_particle_emitter->element.angle     = 0;
+
+    element_particle_emitter->element.image.ref             = R_OBJECT_REF_INVALID;
+    element_particle_emitter->element.image.value.object    = (r_object_t*)(&r_image_cache_default_image);
+    element_particle_emitter->element.color.ref             = R_OBJECT_REF_INVALID;
+    element_particle_emitter->element.color.value.object    = (r_object_t*)(&r_color_white);
+
+    element_particle_emitter->emitting  = R_TRUE;
+    element_particle_emitter->rate      = 0;
+    element_particle_emitter->life      = 1000;
+    element_particle_emitter->speed     = 0;
+    element_particle_emitter->spread    = 360;
+    element_particle_emitter->gravity_x = 0;
+    element_particle_emitter->gravity_y = 0;
+    element_particle_emitter->frames    = 1;
+    element_particle_emitter->maximum   = 1000;
+
+    element_particle_emitter->start_color.ref           = R_OBJECT_REF_INVALID;
+    element_particle_emitter->start_color.value.object  = (r_object_t*)(&r_color_white);
+    element_particle_emitter->end_color.ref             = R_OBJECT_REF_INVALID;
+    element_particle_emitter->end_color.value.object    = (r_object_t*)(&r_color_white);
+
+    element_particle_emitter->emit_remainder    = 0;
+    element_particle_emitter->pending           = 0;
+    element_particle_emitter->count             = 0;
+    element_particle_emitter->allocated         = 0;
+    element_particle_emitter->particles         = NULL;
+
+    return R_SUCCESS;
+}
+
+static r_status_t r_element_particle_emitter_cleanup(r_state_t *rs, r_object_t *object)
+{
+    r_element_particle_emitter_t *element_particle_emitter = (r_element_particle_emitter_t*)object;
+
+    if (element_particle_emitter->particles != NULL)
+    {
+        free(element_particle_emitter->particles);
+        element_particle_emitter->particles = NULL;
+    }
+
+    element_particle_emitter->count = 0;
+    element_particle_emitter->allocated = 0;
+
+    return R_SUCCESS;
+}
+
+r_object_header_t r_element_particle_emitter_header = { R_OBJECT_TYPE_ELEMENT, sizeof(r_element_particle_emitter_t), R_FALSE, r_element_particle_emitter_fields, r_element_particle_emitter_init, NULL, r_element_particle_emitter_cleanup };
+
+static int l_Element_ParticleEmitter_new(lua_State *ls)
+{
+    return l_Object_new(ls, &r_element_particle_emitter_header);
+}
+
+R_INLINE r_real_t r_particle_random()
+{
+    return ((r_real_t)rand()) / RAND_MAX;
+}
+
+static void r_particle_update_appearance(const r_element_particle_emitter_t *element_particle_emitter, r_particle_t *particle)
+{
+    /* Interpolate color and pick the frame based on age */
+    const r_color_t *start_color = (const r_color_t*)element_particle_emitter->start_color.value.object;
+    const r_color_t *end_color = (const r_color_t*)element_particle_emitter->end_color.value.object;
+    const r_real_t t = (particle->life_ms > 0) ? R_CLAMP(particle->age_ms / particle->life_ms, 0, 1) : 0;
+
+    if (start_color == NULL)
+    {
+        start_color = &r_color_white;
+    }
+
+    if (end_color == NULL)
+    {
+        end_color = &r_color_white;
+    }
+
+    particle->color[0] = start_color->red + (end_color->red - start_color->red) * t;
+    particle->color[1] = start_color->green + (end_color->green - start_color->green) * t;
+    particle->color[2] = start_color->blue + (end_color->blue - start_color->blue) * t;
+    particle->color[3] = start_color->opacity + (end_color->opacity - start_color->opacity) * t;
+
+    particle->frame = (element_particle_emitter->frames > 1) ? (R_MIN((unsigned int)(t * element_particle_emitter->frames), element_particle_emitter->frames - 1)) : 0;
+}
+
+static r_status_t r_element_particle_emitter_reserve(r_state_t *rs, r_element_particle_emitter_t *element_particle_emitter)
+{
+    r_status_t status = R_SUCCESS;
+
+    /* Particle storage is (re)allocated whenever the maximum changes */
+    if (element_particle_emitter->allocated != element_particle_emitter->maximum)
+    {
+        r_particle_t *particles = NULL;
+
+        if (element_particle_emitter->maximum > 0)
+        {
+            particles = (r_particle_t*)realloc(element_particle_emitter->particles, element_particle_emitter->maximum * sizeof(r_particle_t));
+            status = (particles != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+        }
+        else
+        {
+            free(element_particle_emitter->particles);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            element_particle_emitter->particles = particles;
+            element_particle_emitter->allocated = element_particle_emitter->maximum;
+            element_particle_emitter->count = R_MIN(element_particle_emitter->count, element_particle_emitter->allocated);
+        }
+    }
+
+    return status;
+}
+
+static r_status_t r_element_particle_emitter_emit(r_state_t *rs, r_element_particle_emitter_t *element_particle_emitter, r_transform2d_t *transform, unsigned int count)
+{
+    r_status_t status = r_element_particle_emitter_reserve(rs, element_particle_emitter);
+
+    if (R_SUCCEEDED(status))
+    {
+        const r_element_t *element = &element_particle_emitter->element;
+
+        /* Particles beyond the maximum are dropped */
+        for (; count > 0 && element_particle_emitter->count < element_particle_emitter->allocated; --count)
+        {
+            r_particle_t *particle = &element_particle_emitter->particles[element_particle_emitter->count++];
+            const r_real_t direction = (r_real_t)((element->angle + element_particle_emitter->spread * (r_particle_random() - 0.5f)) * R_PI_OVER_180);
+            const r_real_t velocity_x = element_particle_emitter->speed * (r_real_t)cos(direction);
+            const r_real_t velocity_y = element_particle_emitter->speed * (r_real_t)sin(direction);
+            r_vector2d_t position;
+            r_vector2d_t layer_position;
+
+            /* Convert the position and velocity to layer coordinates (velocity is only rotated and scaled) */
+            position[0] = element->x;
+            position[1] = element->y;
+            r_transform2d_transform(transform, &position, &layer_position);
+
+            particle->x = layer_position[0];
+            particle->y = layer_position[1];
+            particle->velocity_x = (*transform)[0][0] * velocity_x + (*transform)[0][1] * velocity_y;
+            particle->velocity_y = (*transform)[1][0] * velocity_x + (*transform)[1][1] * velocity_y;
+            particle->age_ms = 0;
+            particle->life_ms = element_particle_emitter->life;
+
+            r_particle_update_appearance(element_particle_emitter, particle);
+        }
+    }
+
+    return status;
+}
+
+r_status_t r_element_particle_emitter_update(r_state_t *rs, r_element_particle_emitter_t *element_particle_emitter, r_transform2d_t *transform, unsigned int difference_ms)
+{
+    r_status_t status = (rs != NULL && element_particle_emitter != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        status = r_element_particle_emitter_reserve(rs, element_particle_emitter);
+    }
+
+    /* Advance live particles (note: velocity and gravity are per second) */
+    if (R_SUCCEEDED(status))
+    {
+        const r_real_t seconds = ((r_real_t)difference_ms) / 1000;
+        const r_real_t gravity_x = element_particle_emitter->gravity_x * seconds;
+        const r_real_t gravity_y = element_particle_emitter->gravity_y * seconds;
+        unsigned int i = 0;
+
+        while (i < element_particle_emitter->count)
+        {
+            r_particle_t *particle = &element_particle_emitter->particles[i];
+
+            particle->age_ms += difference_ms;
+
+            if (particle->age_ms >= particle->life_ms)
+            {
+                /* Expired; move the last particle into this slot */
+                *particle = element_particle_emitter->particles[--element_particle_emitter->count];
+            }
+            else
+            {
+                particle->velocity_x += gravity_x;
+                particle->velocity_y += gravity_y;
+                particle->x += particle->velocity_x * seconds;
+                particle->y += particle->velocity_y * seconds;
+
+                r_particle_update_appearance(element_particle_emitter, particle);
+                ++i;
+            }
+        }
+
+        /* Emit new particles (requested bursts first) */
+        if (transform != NULL)
+        {
+            unsigned int count = element_particle_emitter->pending;
+
+            element_particle_emitter->pending = 0;
+
+            if (element_particle_emitter->emitting && element_particle_emitter->rate > 0)
+            {
+                unsigned int rate_count;
+
+                element_particle_emitter->emit_remainder += element_particle_emitter->rate * seconds;
+                rate_count = (unsigned int)element_particle_emitter->emit_remainder;
+                element_particle_emitter->emit_remainder -= rate_count;
+                count += rate_count;
+            }
+
+            status = r_element_particle_emitter_emit(rs, element_particle_emitter, transform, count);
+        }
+        else
+        {
+            element_particle_emitter->pending = 0;
+        }
+    }
+
+    return status;
+}
+
+static int l_Element_ParticleEmitter_emit(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT },
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_t *element = (r_element_t*)lua_touserdata(ls, 1);
+
+        status = (element->element_type == R_ELEMENT_TYPE_PARTICLE_EMITTER) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+        if (R_SUCCEEDED(status))
+        {
+            /* Request a burst of particles (emitted during the next update); counts below one emit nothing, and bursts beyond
+             * the maximum number of particles are truncated (before conversion, to avoid overflow) */
+            r_element_particle_emitter_t *element_particle_emitter = (r_element_particle_emitter_t*)element;
+            const lua_Number count = lua_tonumber(ls, 2);
+
+            if (count >= 1)
+            {
+                const unsigned int available = element_particle_emitter->maximum - (R_MIN(element_particle_emitter->pending, element_particle_emitter->maximum));
+
+                element_particle_emitter->pending += (count < available) ? (unsigned int)count : available;
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Element_ParticleEmitter_clear(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_t *element = (r_element_t*)lua_touserdata(ls, 1);
+
+        status = (element->element_type == R_ELEMENT_TYPE_PARTICLE_EMITTER) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+        if (R_SUCCEEDED(status))
+        {
+            /* Remove all live particles */
+            r_element_particle_emitter_t *element_particle_emitter = (r_element_particle_emitter_t*)element;
+
+            element_particle_emitter->count = 0;
+            element_particle_emitter->emit_remainder = 0;
+            element_particle_emitter->pending = 0;
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+/* Tilemap elements */
+r_object_ref_t r_element_tilemap_ref_set_tile  = { R_OBJECT_REF_INVALID, { NULL } };
+r_object_ref_t r_element_tilemap_ref_get_tile  = { R_OBJECT_REF_INVALID, { NULL } };
+r_object_ref_t r_element_tilemap_ref_clear     = { R_OBJECT_REF_INVALID, { NULL } };
+
+static void r_element_tilemap_invalidate(r_element_tilemap_t *element_tilemap)
+{
+    if (element_tilemap->chunks != NULL)
+    {
+        unsigned int i;
+
+        for (i = 0; i < element_tilemap->chunk_columns * element_tilemap->chunk_rows; ++i)
+        {
+            element_tilemap->chunks[i].dirty = R_TRUE;
+        }
+    }
+}
+
+static void r_element_tilemap_free(r_element_tilemap_t *element_tilemap)
+{
+    if (element_tilemap->chunks != NULL)
+    {
+        unsigned int i;
+
+        for (i = 0; i < element_tilemap->chunk_columns * element_tilemap->chunk_rows; ++i)
+        {
+            free(element_tilemap->chunks[i].vertices);
+        }
+
+        free(element_tilemap->chunks);
+        element_tilemap->chunks = NULL;
+    }
+
+    if (element_tilemap->tiles != NULL)
+    {
+        free(element_tilemap->tiles);
+        element_tilemap->tiles = NULL;
+    }
+
+    element_tilemap->allocated_columns = 0;
+    element_tilemap->allocated_rows = 0;
+    element_tilemap->chunk_columns = 0;
+    element_tilemap->chunk_rows = 0;
+}
+
+static r_status_t r_element_tilemap_atlas_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
+{
+    /* Texture coordinates depend on the atlas layout, so all geometry must be rebuilt */
+    r_status_t status = r_object_field_write_unsigned_int(rs, object, field, value, value_index);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_tilemap_invalidate((r_element_tilemap_t*)object);
+    }
+
+    return status;
+}
+
+r_object_field_t r_element_tilemap_fields[] = {
+    { "image",        LUA_TSTRING,   0,                   offsetof(r_element_tilemap_t, element.image),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_image_read, NULL, r_object_field_image_write },
+    { "x",            LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, element.x),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "y",            LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, element.y),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "z",            LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, element.z),            R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "width",        LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, element.width),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "height",       LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, element.height),       R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "angle",        LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, element.angle),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "color",        LUA_TUSERDATA, R_OBJECT_TYPE_COLOR, offsetof(r_element_tilemap_t, element.color),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, NULL, NULL, NULL },
+    { "columns",      LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, columns),              R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "rows",         LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, rows),                 R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "atlasColumns", LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, atlas_columns),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_read_unsigned_int, NULL, r_element_tilemap_atlas_field_write },
+    { "atlasRows",    LUA_TNUMBER,   0,                   offsetof(r_element_tilemap_t, atlas_rows),           R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL, r_object_field_read_unsigned_int, NULL, r_element_tilemap_atlas_field_write },
+    { "type",         LUA_TSTRING,   0,                   offsetof(r_element_tilemap_t, element.element_type), R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_element_type_field_read, NULL, NULL },
+    { "setTile",      LUA_TFUNCTION, 0,                   0,                                                   R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_element_tilemap_ref_set_tile, NULL },
+    { "getTile",      LUA_TFUNCTION, 0,                   0,                                                   R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_element_tilemap_ref_get_tile, NULL },
+    { "clear",        LUA_TFUNCTION, 0,                   0,                                                   R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_element_tilemap_ref_clear, NULL },
+    { "set",          LUA_TFUNCTION, 0,                   0,                                                   R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_set, NULL },
+    { "get",          LUA_TFUNCTION, 0,                   0,                                                   R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
+    { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
+};
+
+static r_status_t r_element_tilemap_init(r_state_t *rs, r_object_t *object)
+{
+    r_element_tilemap_t *element_tilemap = (r_element_tilemap_t*)object;
+
+    element_tilemap->element.element_type = R_ELEMENT_TYPE_TILEMAP;
+
+    element_tilemap->element.x      = 0;
+    element_tilemap->element.y      = 0;
+    element_tilemap->element.z      = 0;
+    element_tilemap->element.width  = 1;
+    element_tilemap->element.height = 1;
+    element_tilemap->element.angle  = 0;
+
+    element_tilemap->element.image.ref          = R_OBJECT_REF_INVALID;
+    element_tilemap->element.image.value.object = (r_object_t*)(&r_image_cache_default_image);
+    element_tilemap->element.color.ref          = R_OBJECT_REF_INVALID;
+    element_tilemap->element.color.value.object = (r_object_t*)(&r_color_white);
+
+    element_tilemap->columns        = 0;
+    element_tilemap->rows           = 0;
+    element_tilemap->atlas_columns  = 1;
+    element_tilemap->atlas_rows     = 1;
+
+    element_tilemap->allocated_columns  = 0;
+    element_tilemap->allocated_rows     = 0;
+    element_tilemap->tiles              = NULL;
+    element_tilemap->chunk_columns      = 0;
+    element_tilemap->chunk_rows         = 0;
+    element_tilemap->chunks             = NULL;
+
+    return R_SUCCESS;
+}
+
+static r_status_t r_element_tilemap_cleanup(r_state_t *rs, r_object_t *object)
+{
+    r_element_tilemap_free((r_element_tilemap_t*)object);
+
+    return R_SUCCESS;
+}
+
+r_object_header_t r_element_tilemap_header = { R_OBJECT_TYPE_ELEMENT, sizeof(r_element_tilemap_t), R_FALSE, r_element_tilemap_fields, r_element_tilemap_init, NULL, r_element_tilemap_cleanup };
+
+static int l_Element_Tilemap_new(lua_State *ls)
+{
+    return l_Object_new(ls, &r_element_tilemap_header);
+}
+
+r_status_t r_element_tilemap_reserve(r_state_t *rs, r_element_tilemap_t *element_tilemap)
+{
+    r_status_t status = R_SUCCESS;
+
+    /* Storage is (re)allocated when the dimensions change (which clears all tiles) */
+    if (element_tilemap->allocated_columns != element_tilemap->columns || element_tilemap->allocated_rows != element_tilemap->rows)
+    {
+        r_element_tilemap_free(element_tilemap);
+
+        if (element_tilemap->columns > 0 && element_tilemap->rows > 0)
+        {
+            const unsigned int chunk_columns = (element_tilemap->columns + R_TILEMAP_CHUNK_SIZE - 1) / R_TILEMAP_CHUNK_SIZE;
+            const unsigned int chunk_rows = (element_tilemap->rows + R_TILEMAP_CHUNK_SIZE - 1) / R_TILEMAP_CHUNK_SIZE;
+
+            element_tilemap->tiles = (unsigned short*)calloc(element_tilemap->columns * element_tilemap->rows, sizeof(unsigned short));
+            element_tilemap->chunks = (r_tilemap_chunk_t*)calloc(chunk_columns * chunk_rows, sizeof(r_tilemap_chunk_t));
+            status = (element_tilemap->tiles != NULL && element_tilemap->chunks != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+            if (R_SUCCEEDED(status))
+            {
+                element_tilemap->allocated_columns = element_tilemap->columns;
+                element_tilemap->allocated_rows = element_tilemap->rows;
+                element_tilemap->chunk_columns = chunk_columns;
+                element_tilemap->chunk_rows = chunk_rows;
+            }
+            else
+            {
+                free(element_tilemap->tiles);
+                free(element_tilemap->chunks);
+                element_tilemap->tiles = NULL;
+                element_tilemap->chunks = NULL;
+            }
+        }
+    }
+
+    return status;
+}
+
+R_INLINE r_real_t *r_tilemap_vertex_set(r_real_t *vertex, r_real_t x, r_real_t y, r_real_t u, r_real_t v)
+{
+    vertex[0] = x;
+    vertex[1] = y;
+    vertex[2] = u;
+    vertex[3] = v;
+
+    return vertex + 4;
+}
+
+r_status_t r_element_tilemap_chunk_build(r_state_t *rs, r_element_tilemap_t *element_tilemap, unsigned int chunk_column, unsigned int chunk_row)
+{
+    r_status_t status = (element_tilemap != NULL && element_tilemap->chunks != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (chunk_column < element_tilemap->chunk_columns && chunk_row < element_tilemap->chunk_rows) ? R_SUCCESS : R_F_INVALID_INDEX;
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        r_tilemap_chunk_t *chunk = &element_tilemap->chunks[chunk_row * element_tilemap->chunk_columns + chunk_column];
+
+        if (chunk->dirty || chunk->vertices == NULL)
+        {
+            const unsigned int i1 = chunk_column * R_TILEMAP_CHUNK_SIZE;
+            const unsigned int j1 = chunk_row * R_TILEMAP_CHUNK_SIZE;
+            const unsigned int i2 = R_MIN(i1 + R_TILEMAP_CHUNK_SIZE, element_tilemap->columns);
+            const unsigned int j2 = R_MIN(j1 + R_TILEMAP_CHUNK_SIZE, element_tilemap->rows);
+            const unsigned int atlas_columns = R_MAX(element_tilemap->atlas_columns, 1);
+            const unsigned int atlas_rows = R_MAX(element_tilemap->atlas_rows, 1);
+            const r_real_t atlas_u = ((r_real_t)1) / atlas_columns;
+            const r_real_t atlas_v = ((r_real_t)1) / atlas_rows;
+            r_real_t *vertices = chunk->vertices;
+            unsigned int i, j;
+
+            /* Always allocate space for a full chunk so rebuilding never reallocates */
+            if (vertices == NULL)
+            {
+                vertices = (r_real_t*)malloc(R_TILEMAP_CHUNK_SIZE * R_TILEMAP_CHUNK_SIZE * 4 * 4 * sizeof(r_real_t));
+                status = (vertices != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                r_real_t *vertex = vertices;
+
+                for (j = j1; j < j2; ++j)
+                {
+                    for (i = i1; i < i2; ++i)
+                    {
+                        const unsigned int tile = element_tilemap->tiles[j * element_tilemap->columns + i];
+
+                        if (tile > 0 && tile <= atlas_columns * atlas_rows)
+                        {
+                            const r_real_t x1 = (r_real_t)i;
+                            const r_real_t y1 = -(r_real_t)j;
+                            const r_real_t u1 = ((tile - 1) % atlas_columns) * atlas_u;
+                            const r_real_t v1 = ((tile - 1) / atlas_columns) * atlas_v;
+
+                            vertex = r_tilemap_vertex_set(vertex, x1, y1, u1, v1);
+                            vertex = r_tilemap_vertex_set(vertex, x1, y1 - 1, u1, v1 + atlas_v);
+                            vertex = r_tilemap_vertex_set(vertex, x1 + 1, y1 - 1, u1 + atlas_u, v1 + atlas_v);
+                            vertex = r_tilemap_vertex_set(vertex, x1 + 1, y1, u1 + atlas_u, v1);
+                        }
+                    }
+                }
+
+                chunk->vertices = vertices;
+                chunk->vertex_count = (unsigned int)(vertex - vertices) / 4;
+                chunk->dirty = R_FALSE;
+            }
+        }
+    }
+
+    return status;
+}
+
+static int l_Element_Tilemap_setTile(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT },
+        { LUA_TNUMBER, 0 },
+        { LUA_TNUMBER, 0 },
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_t *element = (r_element_t*)lua_touserdata(ls, 1);
+
+        status = (element->element_type == R_ELEMENT_TYPE_TILEMAP) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_element_tilemap_t *element_tilemap = (r_element_tilemap_t*)element;
+
+            status = r_element_tilemap_reserve(rs, element_tilemap);
+
+            if (R_SUCCEEDED(status))
+            {
+                const int i = (int)lua_tonumber(ls, 2);
+                const int j = (int)lua_tonumber(ls, 3);
+                const int tile = (int)lua_tonumber(ls, 4);
+
+                status = (i >= 0 && j >= 0 && (unsigned int)i < element_tilemap->columns && (unsigned int)j < element_tilemap->rows && tile >= 0 && tile <= 0xffff) ? R_SUCCESS : RS_F_INVALID_INDEX;
+
+                if (R_SUCCEEDED(status))
+                {
+                    unsigned short *value = &element_tilemap->tiles[j * element_tilemap->columns + i];
+
+                    /* Only the chunk containing this tile needs to be rebuilt */
+                    if (*value != (unsigned short)tile)
+                    {
+                        *value = (unsigned short)tile;
+                        element_tilemap->chunks[(j / R_TILEMAP_CHUNK_SIZE) * element_tilemap->chunk_columns + (i / R_TILEMAP_CHUNK_SIZE)].dirty = R_TRUE;
+                    }
+                }
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Element_Tilemap_getTile(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT },
+        { LUA_TNUMBER, 0 },
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+    int result_count = 0;
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_t *element = (r_element_t*)lua_touserdata(ls, 1);
+
+        status = (element->element_type == R_ELEMENT_TYPE_TILEMAP) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_element_tilemap_t *element_tilemap = (r_element_tilemap_t*)element;
+
+            status = r_element_tilemap_reserve(rs, element_tilemap);
+
+            if (R_SUCCEEDED(status))
+            {
+                const int i = (int)lua_tonumber(ls, 2);
+                const int j = (int)lua_tonumber(ls, 3);
+
+                status = (i >= 0 && j >= 0 && (unsigned int)i < element_tilemap->columns && (unsigned int)j < element_tilemap->rows) ? R_SUCCESS : RS_F_INVALID_INDEX;
+
+                if (R_SUCCEEDED(status))
+                {
+                    lua_pushnumber(ls, (lua_Number)element_tilemap->tiles[j * element_tilemap->columns + i]);
+                    lua_insert(ls, 1);
+                    result_count = 1;
+                }
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Element_Tilemap_clear(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_t *element = (r_element_t*)lua_touserdata(ls, 1);
+
+        status = (element->element_type == R_ELEMENT_TYPE_TILEMAP) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_element_tilemap_t *element_tilemap = (r_element_tilemap_t*)element;
+
+            status = r_element_tilemap_reserve(rs, element_tilemap);
+
+            if (R_SUCCEEDED(status) && element_tilemap->tiles != NULL)
+            {
+                memset(element_tilemap->tiles, 0, element_tilemap->columns * element_tilemap->rows * sizeof(unsigned short));
+                r_element_tilemap_invalidate(element_tilemap);
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
 r_status_t r_element_setup(r_state_t *rs)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -464,12 +1430,16 @@ r_status_t r_element_setup(r_state_t *rs)
             r_script_node_t element_image_region_nodes[]    = { { "new", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_ImageRegion_new }, { NULL } };
             r_script_node_t element_animation_nodes[]       = { { "new", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Animation_new }, { NULL } };
             r_script_node_t element_text_nodes[]            = { { "new", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Text_new },  { NULL } };
+            r_script_node_t element_particle_emitter_nodes[] = { { "new", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_ParticleEmitter_new },  { NULL } };
+            r_script_node_t element_tilemap_nodes[]         = { { "new", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Tilemap_new },  { NULL } };
 
             r_script_node_t element_nodes[] = {
                 { "Image", R_SCRIPT_NODE_TYPE_TABLE, element_image_nodes },
                 { "ImageRegion", R_SCRIPT_NODE_TYPE_TABLE, element_image_region_nodes },
                 { "Animation", R_SCRIPT_NODE_TYPE_TABLE, element_animation_nodes },
                 { "Text",  R_SCRIPT_NODE_TYPE_TABLE, element_text_nodes },
+                { "ParticleEmitter", R_SCRIPT_NODE_TYPE_TABLE, element_particle_emitter_nodes },
+                { "Tilemap", R_SCRIPT_NODE_TYPE_TABLE, element_tilemap_nodes },
                 { NULL }
             };
 
@@ -478,6 +1448,11 @@ r_status_t r_element_setup(r_state_t *rs)
                 { LUA_GLOBALSINDEX, NULL, { "Element", R_SCRIPT_NODE_TYPE_TABLE, element_nodes } },
                 { 0, &r_animation_ref_add_frame, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Animation_addFrame } },
                 { 0, &r_element_animation_reset, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Animation_reset } },
+                { 0, &r_element_particle_emitter_ref_emit, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_ParticleEmitter_emit } },
+                { 0, &r_element_particle_emitter_ref_clear, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_ParticleEmitter_clear } },
+                { 0, &r_element_tilemap_ref_set_tile, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Tilemap_setTile } },
+                { 0, &r_element_tilemap_ref_get_tile, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Tilemap_getTile } },
+                { 0, &r_element_tilemap_ref_clear, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Element_Tilemap_clear } },
                 { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
             };
 
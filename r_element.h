@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "r_object_ref.h"
 #include "r_image_cache.h"
 #include "r_list.h"
+#include "r_transform2d.h"
 
 typedef enum
 {
@@ -35,6 +36,8 @@ typedef enum
     R_ELEMENT_TYPE_IMAGE_REGION,
     R_ELEMENT_TYPE_ANIMATION,
     R_ELEMENT_TYPE_TEXT,
+    R_ELEMENT_TYPE_PARTICLE_EMITTER,
+    R_ELEMENT_TYPE_TILEMAP,
     R_ELEMENT_TYPE_MAX
 } r_element_type_t;
 
@@ -81,6 +84,7 @@ typedef struct
 {
     r_object_ref_t  image;
     r_real_t        ms;
+    r_real_t        end_ms; /* Cumulative time at the end of this frame */
 } r_animation_frame_t;
 
 typedef r_list_t r_animation_frame_list_t;
@@ -93,24 +97,122 @@ typedef struct
     r_boolean_t                 loop;
     r_boolean_t                 transient;
     r_animation_frame_list_t    frames;
+    r_real_t                    duration_ms;
 } r_animation_t;
 
+extern unsigned int r_animation_get_frame_index(r_state_t *rs, const r_animation_t *animation, r_real_t elapsed_ms);
+
+/* Synchronized animation elements play relative to the state's shared animation clock and need no per-element updates */
 typedef struct
 {
     r_element_t     element;
-    unsigned int    frame_index;
-    r_real_t        frame_ms;
+    r_boolean_t     synchronized;
+    unsigned int    start_ms;
+    r_real_t        elapsed_ms;
 } r_element_animation_t;
 
-/* Text */
+extern r_real_t r_element_animation_get_elapsed_ms(r_state_t *rs, const r_element_animation_t *element_animation);
+
+/* Text (glyph geometry is cached and only rebuilt when the text, buffer contents, or alignment change) */
+typedef struct
+{
+    r_real_t    x;
+    r_real_t    u1;
+    r_real_t    v1;
+    r_real_t    u2;
+    r_real_t    v2;
+} r_glyph_t;
+
 typedef struct
 {
     r_element_t                 element;
     r_element_text_alignment_t  alignment;
     r_object_ref_t              text;
     r_object_ref_t              buffer;
+
+    r_boolean_t                 glyphs_dirty;
+    unsigned int                glyphs_version;
+    unsigned int                glyph_count;
+    unsigned int                glyphs_allocated;
+    r_glyph_t                   *glyphs;
 } r_element_text_t;
 
+extern r_status_t r_element_text_glyphs_build(r_state_t *rs, r_element_text_t *element_text);
+
+/* Particle emitters (particles are emitted relative to the element but simulated in the layer's coordinate space, so moving
+ * the emitter or its entity leaves a trail; gravity is in layer coordinates) */
+typedef struct
+{
+    r_real_t        x;
+    r_real_t        y;
+    r_real_t        velocity_x;
+    r_real_t        velocity_y;
+    r_real_t        age_ms;
+    r_real_t        life_ms;
+    r_real_t        color[4];
+    unsigned int    frame;
+} r_particle_t;
+
+typedef struct
+{
+    r_element_t     element;
+
+    /* Emission parameters (element.angle is the direction of emission, in degrees) */
+    r_boolean_t     emitting;
+    r_real_t        rate;
+    r_real_t        life;
+    r_real_t        speed;
+    r_real_t        spread;
+    r_real_t        gravity_x;
+    r_real_t        gravity_y;
+    unsigned int    frames;
+    unsigned int    maximum;
+    r_object_ref_t  start_color;
+    r_object_ref_t  end_color;
+
+    /* Live particles (bursts requested from scripts are emitted during the next update, once the emitter's position in the
+     * layer is known) */
+    r_real_t        emit_remainder;
+    unsigned int    pending;
+    unsigned int    count;
+    unsigned int    allocated;
+    r_particle_t    *particles;
+} r_element_particle_emitter_t;
+
+/* Note: transform maps the entity's coordinates to the layer's; if it is NULL, no particles are emitted */
+extern r_status_t r_element_particle_emitter_update(r_state_t *rs, r_element_particle_emitter_t *element_particle_emitter, r_transform2d_t *transform, unsigned int difference_ms);
+
+/* Tilemaps (tile (i, j) covers [i, i + 1] x [-j - 1, -j] before scaling by width and height; tile 0 is empty and tile n is the nth cell of the atlas image) */
+#define R_TILEMAP_CHUNK_SIZE    16
+
+typedef struct
+{
+    r_boolean_t     dirty;
+    unsigned int    vertex_count;
+    r_real_t        *vertices; /* x, y, u, v */
+} r_tilemap_chunk_t;
+
+typedef struct
+{
+    r_element_t         element;
+
+    unsigned int        columns;
+    unsigned int        rows;
+    unsigned int        atlas_columns;
+    unsigned int        atlas_rows;
+
+    /* Tile indices are stored row by row; geometry is cached per chunk and only rebuilt when tiles change */
+    unsigned int        allocated_columns;
+    unsigned int        allocated_rows;
+    unsigned short      *tiles;
+    unsigned int        chunk_columns;
+    unsigned int        chunk_rows;
+    r_tilemap_chunk_t   *chunks;
+} r_element_tilemap_t;
+
+extern r_status_t r_element_tilemap_reserve(r_state_t *rs, r_element_tilemap_t *element_tilemap);
+extern r_status_t r_element_tilemap_chunk_build(r_state_t *rs, r_element_tilemap_t *element_tilemap, unsigned int chunk_column, unsigned int chunk_row);
+
 extern r_status_t r_element_setup(r_state_t *rs);
 
 #endif
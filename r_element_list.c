@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "r_assert.h"
 #include "r_element.h"
 #include "r_element_list.h"
+#include "r_entity.h"
 #include "r_script.h"
 
 r_object_ref_t r_element_list_ref_new       = { R_OBJECT_REF_INVALID, { NULL } };
@@ -46,6 +47,11 @@ static int r_element_compare(r_object_t *a, r_object_t *b)
 
 static r_status_t r_element_list_init(r_state_t *rs, r_object_t *object)
 {
+    r_element_list_t *element_list = (r_element_list_t*)object;
+
+    element_list->entity = NULL;
+    element_list->shared = R_FALSE;
+
     return r_zlist_init(rs, object, R_OBJECT_TYPE_ELEMENT_LIST, R_OBJECT_TYPE_ELEMENT, r_element_compare);
 }
 
@@ -54,8 +60,24 @@ static r_status_t r_element_list_cleanup(r_state_t *rs, r_object_t *object)
     return r_zlist_cleanup(rs, object, R_OBJECT_TYPE_ELEMENT_LIST);
 }
 
+static void r_element_list_invalidate_activity(lua_State *ls)
+{
+    /* Animated elements may have been added to (or removed from) the list's entity (note: light userdata isn't an object) */
+    if (lua_type(ls, 1) == LUA_TUSERDATA)
+    {
+        r_element_list_t *element_list = (r_element_list_t*)lua_touserdata(ls, 1);
+
+        if (((r_object_t*)element_list)->header->type == R_OBJECT_TYPE_ELEMENT_LIST && element_list->entity != NULL)
+        {
+            r_entity_invalidate_activity(element_list->entity);
+        }
+    }
+}
+
 static int l_ElementList_add(lua_State *ls)
 {
+    r_element_list_invalidate_activity(ls);
+
     return l_ZList_add(ls, R_OBJECT_TYPE_ELEMENT_LIST);
 }
 
@@ -66,11 +88,15 @@ static int l_ElementList_forEach(lua_State *ls)
 
 static int l_ElementList_remove(lua_State *ls)
 {
+    r_element_list_invalidate_activity(ls);
+
     return l_ZList_remove(ls, R_OBJECT_TYPE_ELEMENT_LIST, R_OBJECT_TYPE_ELEMENT);
 }
 
 static int l_ElementList_clear(lua_State *ls)
 {
+    r_element_list_invalidate_activity(ls);
+
     return l_ZList_clear(ls, R_OBJECT_TYPE_ELEMENT_LIST);
 }
 
@@ -89,9 +115,40 @@ static int l_ElementList_new(lua_State *ls)
     return l_Object_new(ls, &r_element_list_header);
 }
 
+void r_element_list_attach(r_state_t *rs, r_element_list_t *element_list, r_entity_t *entity)
+{
+    if (!element_list->shared && element_list->entity != entity)
+    {
+        if (element_list->entity == NULL)
+        {
+            element_list->entity = entity;
+        }
+        else
+        {
+            /* Shared lists can't notify all their entities, so the entities never cache their activity */
+            r_entity_invalidate_activity(element_list->entity);
+            element_list->entity = NULL;
+            element_list->shared = R_TRUE;
+        }
+    }
+}
+
+void r_element_list_detach(r_state_t *rs, r_element_list_t *element_list, r_entity_t *entity)
+{
+    if (element_list->entity == entity)
+    {
+        element_list->entity = NULL;
+    }
+}
+
 r_status_t r_element_list_remove_index(r_state_t *rs, r_object_t *parent, r_element_list_t *element_list, unsigned int item)
 {
-    return r_zlist_remove_index(rs, parent, element_list, item);
+    if (element_list->entity != NULL)
+    {
+        r_entity_invalidate_activity(element_list->entity);
+    }
+
+    return r_zlist_remove_index(rs, parent, &element_list->zlist, item);
 }
 
 r_status_t r_element_list_setup(r_state_t *rs)
@@ -121,5 +178,13 @@ r_status_t r_element_list_setup(r_state_t *rs)
 
 r_status_t r_element_list_field_init(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value)
 {
-    return r_object_field_object_init_new(rs, object, value, R_OBJECT_TYPE_ELEMENT_LIST, &r_element_list_ref_new);
+    /* Note: this is only used for entities */
+    r_status_t status = r_object_field_object_init_new(rs, object, value, R_OBJECT_TYPE_ELEMENT_LIST, &r_element_list_ref_new);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_element_list_attach(rs, (r_element_list_t*)((r_object_ref_t*)value)->value.object, (r_entity_t*)object);
+    }
+
+    return status;
 }
@@ -27,8 +27,19 @@ THE SOFTWARE.
 
 #include "r_zlist.h"
 
-typedef r_zlist_t r_element_list_t;
-
+struct _r_entity;
+
+/* Element lists point back to the entity that owns them (if any) so that the entity can be notified when elements are
+ * added or removed; lists shared by several entities have no owner */
+typedef struct
+{
+    r_zlist_t           zlist;
+    struct _r_entity    *entity;
+    r_boolean_t         shared;
+} r_element_list_t;
+
+extern void r_element_list_attach(r_state_t *rs, r_element_list_t *element_list, struct _r_entity *entity);
+extern void r_element_list_detach(r_state_t *rs, r_element_list_t *element_list, struct _r_entity *entity);
 extern r_status_t r_element_list_remove_index(r_state_t *rs, r_object_t *parent, r_element_list_t *element_list, unsigned int item);
 
 extern r_status_t r_element_list_setup(r_state_t *rs);
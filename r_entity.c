@@ -21,6 +21,7 @@ THE SOFTWARE.
 */
 
 #include <lua.h>
+#include <math.h>
 
 #include "r_assert.h"
 #include "r_color.h"
@@ -29,6 +30,8 @@ THE SOFTWARE.
 #include "r_script.h"
 #include "r_entity_list.h"
 #include "r_mesh.h"
+#include "r_profiler.h"
+#include "r_video.h"
 
 static void r_entity_increment_version(r_entity_t *entity)
 {
@@ -49,10 +52,28 @@ static void r_entity_increment_version(r_entity_t *entity)
     }
 }
 
+static void r_entity_save_previous_transform(r_state_t *rs, r_entity_t *entity)
+{
+    /* Only the transformation from the start of the step is needed */
+    if (entity->previous_step != rs->update_step)
+    {
+        entity->previous_valid  = R_TRUE;
+        entity->previous_step   = rs->update_step;
+        entity->previous_x      = entity->x;
+        entity->previous_y      = entity->y;
+        entity->previous_width  = entity->width;
+        entity->previous_height = entity->height;
+        entity->previous_angle  = entity->angle;
+    }
+}
+
 static r_status_t r_enitity_transform_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
 {
     /* Write the field normally, but update the transform version */
-    r_status_t status = r_object_field_write_default(rs, object, field, value, value_index);
+    r_status_t status = R_SUCCESS;
+
+    r_entity_save_previous_transform(rs, (r_entity_t*)object);
+    status = r_object_field_write_default(rs, object, field, value, value_index);
 
     if (R_SUCCEEDED(status))
     {
@@ -62,6 +83,42 @@ static r_status_t r_enitity_transform_field_write(r_state_t *rs, r_object_t *obj
     return status;
 }
 
+static r_status_t r_entity_activity_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
+{
+    /* Write the field normally, but invalidate cached activity */
+    r_status_t status = r_object_field_write_default(rs, object, field, value, value_index);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_entity_invalidate_activity((r_entity_t*)object);
+    }
+
+    return status;
+}
+
+static r_status_t r_entity_elements_field_write(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index)
+{
+    /* Write the field normally, but move ownership to the new element list (and invalidate cached activity) */
+    r_entity_t *entity = (r_entity_t*)object;
+    r_status_t status = R_SUCCESS;
+
+    if (entity->elements.value.object != NULL)
+    {
+        r_element_list_detach(rs, (r_element_list_t*)entity->elements.value.object, entity);
+    }
+
+    status = r_object_field_write_default(rs, object, field, value, value_index);
+
+    if (entity->elements.value.object != NULL)
+    {
+        r_element_list_attach(rs, (r_element_list_t*)entity->elements.value.object, entity);
+    }
+
+    r_entity_invalidate_activity(entity);
+
+    return status;
+}
+
 r_object_ref_t r_entity_ref_add_child           = { R_OBJECT_REF_INVALID, { NULL } };
 r_object_ref_t r_entity_ref_remove_child        = { R_OBJECT_REF_INVALID, { NULL } };
 r_object_ref_t r_entity_ref_for_each_child      = { R_OBJECT_REF_INVALID, { NULL } };
@@ -69,6 +126,7 @@ r_object_ref_t r_entity_ref_clear_children      = { R_OBJECT_REF_INVALID, { NULL
 r_object_ref_t r_entity_ref_update_children     = { R_OBJECT_REF_INVALID, { NULL } };
 r_object_ref_t r_entity_ref_convert_to_local    = { R_OBJECT_REF_INVALID, { NULL } };
 r_object_ref_t r_entity_ref_convert_to_absolute = { R_OBJECT_REF_INVALID, { NULL } };
+r_object_ref_t r_entity_ref_set                 = { R_OBJECT_REF_INVALID, { NULL } };
 
 r_object_field_t r_entity_fields[] = {
     { "x",                 LUA_TNUMBER,   0,                          offsetof(r_entity_t, x),        R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, &r_enitity_transform_field_write },
@@ -78,10 +136,12 @@ r_object_field_t r_entity_fields[] = {
     { "height",            LUA_TNUMBER,   0,                          offsetof(r_entity_t, height),   R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, &r_enitity_transform_field_write },
     { "angle",             LUA_TNUMBER,   0,                          offsetof(r_entity_t, angle),    R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, &r_enitity_transform_field_write },
     { "color",             LUA_TUSERDATA, R_OBJECT_TYPE_COLOR,        offsetof(r_entity_t, color),    R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, NULL },
-    { "elements",          LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT_LIST, offsetof(r_entity_t, elements), R_TRUE,  R_OBJECT_INIT_OPTIONAL, r_element_list_field_init, NULL, NULL, NULL },
-    { "update",            LUA_TFUNCTION, 0,                          offsetof(r_entity_t, update),   R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, NULL },
+    { "elements",          LUA_TUSERDATA, R_OBJECT_TYPE_ELEMENT_LIST, offsetof(r_entity_t, elements), R_TRUE,  R_OBJECT_INIT_OPTIONAL, r_element_list_field_init, NULL, NULL, &r_entity_elements_field_write },
+    { "update",            LUA_TFUNCTION, 0,                          offsetof(r_entity_t, update),   R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, &r_entity_activity_field_write },
     { "order",             LUA_TNUMBER,   0,                          offsetof(r_entity_t, order),    R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      NULL, NULL, NULL },
     { "group",             LUA_TNUMBER,   0,                          offsetof(r_entity_t, group),    R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                      r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "sleeping",          LUA_TBOOLEAN,  0,                          offsetof(r_entity_t, sleeping), R_TRUE,  R_OBJECT_INIT_EXCLUDED, NULL,                      NULL, NULL, &r_entity_activity_field_write },
+    { "cacheAsBitmap",     LUA_TBOOLEAN,  0,                          offsetof(r_entity_t, cache_as_bitmap), R_TRUE,  R_OBJECT_INIT_EXCLUDED, NULL,               NULL, NULL, NULL },
     { "mesh",              LUA_TUSERDATA, R_OBJECT_TYPE_MESH,         offsetof(r_entity_t, mesh),     R_TRUE,  R_OBJECT_INIT_EXCLUDED, NULL,                      NULL, NULL, NULL },
     { "parent",            LUA_TUSERDATA, R_OBJECT_TYPE_ENTITY,       offsetof(r_entity_t, parent),   R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL,                      NULL, NULL, NULL },
     { "addChild",          LUA_TFUNCTION, 0,                          0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_entity_ref_add_child, NULL },
@@ -91,6 +151,8 @@ r_object_field_t r_entity_fields[] = {
     { "updateChildren",    LUA_TFUNCTION, 0,                          0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_entity_ref_update_children, NULL },
     { "convertToLocal",    LUA_TFUNCTION, 0,                          0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_entity_ref_convert_to_local, NULL },
     { "convertToAbsolute", LUA_TFUNCTION, 0,                          0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_entity_ref_convert_to_absolute, NULL },
+    { "set",               LUA_TFUNCTION, 0,                          0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_entity_ref_set, NULL },
+    { "get",               LUA_TFUNCTION, 0,                          0,                              R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_object_ref_get, NULL },
     { NULL, LUA_TNIL, 0, 0, R_FALSE, 0, NULL, NULL, NULL, NULL }
 };
 
@@ -111,8 +173,17 @@ static r_status_t r_entity_init(r_state_t *rs, r_object_t *object)
 
     entity->bounds_version = 0;
 
+    entity->sleeping = R_FALSE;
+    entity->active = R_FALSE;
+    entity->active_dirty = R_TRUE;
+    entity->active_version = 0;
+
     entity->version      = 1;
 
+    /* Don't interpolate from the defaults to the initial transformation */
+    entity->previous_valid = R_FALSE;
+    entity->previous_step  = rs->update_step;
+
     entity->x            = 0;
     entity->y            = 0;
     entity->z            = 0;
@@ -123,6 +194,9 @@ static r_status_t r_entity_init(r_state_t *rs, r_object_t *object)
     entity->color.ref           = R_OBJECT_REF_INVALID;
     entity->color.value.object  = (r_object_t*)(&r_color_white);
 
+    entity->cache_as_bitmap = R_FALSE;
+    entity->bitmap_cache = NULL;
+
     entity->order = 0;
     entity->group = 0;
 
@@ -134,6 +208,14 @@ static r_status_t r_entity_cleanup(r_state_t *rs, r_object_t *object)
     r_entity_t *entity = (r_entity_t*)object;
     r_status_t status = R_SUCCESS;
 
+    r_video_bitmap_cache_free(rs, entity->bitmap_cache);
+    entity->bitmap_cache = NULL;
+
+    if (entity->elements.value.object != NULL)
+    {
+        r_element_list_detach(rs, (r_element_list_t*)entity->elements.value.object, entity);
+    }
+
     if (entity->has_children)
     {
         status = r_entity_list_cleanup(rs, &entity->children_display);
@@ -231,6 +313,7 @@ static int l_Entity_addChild(lua_State *ls)
 
                 if (R_SUCCEEDED(status))
                 {
+                    r_entity_invalidate_activity(parent);
                     result_count = l_ZList_add_internal(ls, R_OBJECT_TYPE_ENTITY, offsetof(r_entity_t, children_display));
                 }
             }
@@ -271,6 +354,7 @@ static int l_Entity_removeChild(lua_State *ls)
 
                 if (R_SUCCEEDED(status))
                 {
+                    r_entity_invalidate_activity(parent);
                     result_count = l_ZList_remove_internal(ls, R_OBJECT_TYPE_ENTITY, offsetof(r_entity_t, children_display), R_OBJECT_TYPE_ENTITY);
                 }
             }
@@ -349,6 +433,7 @@ static int l_Entity_clearChildren(lua_State *ls)
 
                 if (R_SUCCEEDED(status))
                 {
+                    r_entity_invalidate_activity(parent);
                     result_count = l_ZList_clear_internal(ls, R_OBJECT_TYPE_ENTITY, offsetof(r_entity_t, children_display));
                 }
             }
@@ -457,6 +542,133 @@ static int l_Entity_convertToAbsolute(lua_State *ls)
     return result_count;
 }
 
+static int l_Entity_set(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, R_OBJECT_TYPE_ENTITY },
+        { LUA_TTABLE, 0 }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        int object_index = 1;
+        int table_index = 2;
+        r_entity_t *entity = (r_entity_t*)lua_touserdata(ls, object_index);
+
+        status = r_object_push_fields(rs, object_index);
+
+        if (R_SUCCEEDED(status))
+        {
+            int fields_index = lua_gettop(ls);
+            r_boolean_t transform_changed = R_FALSE;
+
+            lua_pushnil(ls);
+
+            while (R_SUCCEEDED(status) && lua_next(ls, table_index) != 0)
+            {
+                int key_index = lua_gettop(ls) - 1;
+                int value_index = lua_gettop(ls);
+                const r_object_field_t *field = NULL;
+
+                lua_pushvalue(ls, key_index);
+                lua_rawget(ls, fields_index);
+
+                if (lua_type(ls, -1) == LUA_TLIGHTUSERDATA)
+                {
+                    field = (const r_object_field_t*)lua_touserdata(ls, -1);
+                }
+
+                lua_pop(ls, 1);
+
+                if (field != NULL && field->write == r_enitity_transform_field_write)
+                {
+                    /* Transform fields are written directly; the version is only incremented once below */
+                    r_entity_save_previous_transform(rs, entity);
+                    status = r_object_field_write_default(rs, (r_object_t*)entity, field, (void*)(((r_byte_t*)entity) + field->offset), value_index);
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        transform_changed = R_TRUE;
+                    }
+                }
+                else
+                {
+                    status = r_object_field_write(rs, (r_object_t*)entity, fields_index, object_index, key_index, value_index);
+                }
+
+                lua_pop(ls, 1);
+            }
+
+            if (transform_changed)
+            {
+                r_entity_increment_version(entity);
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+/* Sets positions for an array of entities from parallel arrays of x and y coordinates */
+static int l_Entity_setPositions(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TTABLE, 0 },
+        { LUA_TTABLE, 0 },
+        { LUA_TTABLE, 0 }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        int list_index = 1;
+        int xs_index = 2;
+        int ys_index = 3;
+        int count = (int)lua_objlen(ls, list_index);
+        int i;
+
+        status = ((int)lua_objlen(ls, xs_index) >= count && (int)lua_objlen(ls, ys_index) >= count) ? R_SUCCESS : RS_F_INVALID_INDEX;
+
+        for (i = 1; i <= count && R_SUCCEEDED(status); ++i)
+        {
+            int entity_index = 0;
+
+            lua_rawgeti(ls, list_index, i);
+            entity_index = lua_gettop(ls);
+            lua_rawgeti(ls, xs_index, i);
+            lua_rawgeti(ls, ys_index, i);
+
+            status = (lua_type(ls, entity_index) == LUA_TUSERDATA
+                && ((r_object_t*)lua_touserdata(ls, entity_index))->header->type == R_OBJECT_TYPE_ENTITY
+                && lua_type(ls, entity_index + 1) == LUA_TNUMBER
+                && lua_type(ls, entity_index + 2) == LUA_TNUMBER) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+            if (R_SUCCEEDED(status))
+            {
+                r_entity_t *entity = (r_entity_t*)lua_touserdata(ls, entity_index);
+
+                r_entity_save_previous_transform(rs, entity);
+                entity->x = (r_real_t)lua_tonumber(ls, entity_index + 1);
+                entity->y = (r_real_t)lua_tonumber(ls, entity_index + 2);
+                r_entity_increment_version(entity);
+            }
+
+            lua_pop(ls, 3);
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
 r_status_t r_entity_setup(r_state_t *rs)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -464,7 +676,12 @@ r_status_t r_entity_setup(r_state_t *rs)
 
     if (R_SUCCEEDED(status))
     {
-        r_script_node_t entity_nodes[] = { { "new", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_new }, { NULL } };
+        r_script_node_t entity_nodes[] = {
+            { "new",          R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_new },
+            { "setPositions", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_setPositions },
+            { NULL }
+        };
+
         r_script_node_root_t roots[] = {
             { LUA_GLOBALSINDEX, NULL,                              { "Entity", R_SCRIPT_NODE_TYPE_TABLE, entity_nodes } },
             { 0,                &r_entity_ref_add_child,           { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_addChild } },
@@ -474,6 +691,7 @@ r_status_t r_entity_setup(r_state_t *rs)
             { 0,                &r_entity_ref_update_children,     { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_updateChildren } },
             { 0,                &r_entity_ref_convert_to_local,    { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_convertToLocal } },
             { 0,                &r_entity_ref_convert_to_absolute, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_convertToAbsolute } },
+            { 0,                &r_entity_ref_set,                 { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Entity_set } },
             { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
         };
 
@@ -483,6 +701,101 @@ r_status_t r_entity_setup(r_state_t *rs)
     return status;
 }
 
+static r_boolean_t r_entity_elements_are_active(r_entity_t *entity)
+{
+    r_element_list_t *element_list = (r_element_list_t*)entity->elements.value.object;
+    r_boolean_t active = R_FALSE;
+
+    if (element_list != NULL)
+    {
+        unsigned int i;
+
+        /* The entity isn't notified when a shared list changes, so assume it needs updates */
+        active = element_list->shared;
+
+        for (i = 0; i < element_list->zlist.object_list.count && !active; ++i)
+        {
+            r_element_t *const element = (r_element_t*)element_list->zlist.object_list.items[i].object_ref.value.object;
+
+            if (element != NULL)
+            {
+                if (element->element_type == R_ELEMENT_TYPE_ANIMATION)
+                {
+                    /* Synchronized animations only need updates if they must be removed when finished */
+                    const r_animation_t *animation = (const r_animation_t*)element->image.value.object;
+
+                    active = !((r_element_animation_t*)element)->synchronized || (animation != NULL && animation->transient);
+                }
+                else if (element->element_type == R_ELEMENT_TYPE_PARTICLE_EMITTER)
+                {
+                    active = R_TRUE;
+                }
+            }
+        }
+    }
+
+    return active;
+}
+
+void r_entity_invalidate_activity(r_entity_t *entity)
+{
+    /* Ancestors' activity depends on their descendants, so invalidate them as well */
+    r_entity_t *ancestor;
+
+    for (ancestor = entity; ancestor != NULL; ancestor = (r_entity_t*)ancestor->parent.value.object)
+    {
+        ancestor->active_dirty = R_TRUE;
+    }
+}
+
+r_boolean_t r_entity_is_active(r_state_t *rs, r_entity_t *entity)
+{
+    if (entity->active_dirty || entity->active_version != rs->entity_activity_version)
+    {
+        /* Recompute (note that pending additions/removals are included, so this is conservative) */
+        r_boolean_t active = R_FALSE;
+
+        if (!entity->sleeping)
+        {
+            active = (entity->update.ref != R_OBJECT_REF_INVALID || r_entity_elements_are_active(entity));
+
+            if (!active && entity->has_children)
+            {
+                unsigned int i;
+
+                for (i = 0; i < entity->children_update.object_list.count && !active; ++i)
+                {
+                    r_entity_t *child = (r_entity_t*)entity->children_update.object_list.items[i].object_ref.value.object;
+
+                    if (child != NULL)
+                    {
+                        active = r_entity_is_active(rs, child);
+                    }
+                }
+            }
+        }
+
+        entity->active = active;
+        entity->active_dirty = R_FALSE;
+        entity->active_version = rs->entity_activity_version;
+    }
+
+    return entity->active;
+}
+
+/* Checks to see if an entity (or one of its ancestors) has been scaled to nothing (in which case its absolute transformation can't be computed) */
+static r_boolean_t r_entity_is_degenerate(r_entity_t *entity)
+{
+    r_boolean_t degenerate = R_FALSE;
+
+    for (; entity != NULL && !degenerate; entity = (r_entity_t*)entity->parent.value.object)
+    {
+        degenerate = (entity->width == 0 || entity->height == 0) ? R_TRUE : R_FALSE;
+    }
+
+    return degenerate;
+}
+
 r_status_t r_entity_update(r_state_t *rs, r_entity_t *entity, unsigned int difference_ms)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL && entity != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -490,7 +803,7 @@ r_status_t r_entity_update(r_state_t *rs, r_entity_t *entity, unsigned int diffe
     R_ASSERT(R_SUCCEEDED(status));
 
     /* Update this entity */
-    if (R_SUCCEEDED(status))
+    if (R_SUCCEEDED(status) && entity->update.ref != R_OBJECT_REF_INVALID)
     {
         /* Push the entity's update function (if one exists) */
         status = r_object_ref_push(rs, (r_object_t*)entity, &entity->update);
@@ -509,7 +822,9 @@ r_status_t r_entity_update(r_state_t *rs, r_entity_t *entity, unsigned int diffe
                 {
                     lua_pushnumber(ls, (lua_Number)difference_ms);
 
+                    r_profiler_push(rs, R_PROFILER_PHASE_SCRIPT);
                     status = r_script_call(rs, 2, 0);
+                    r_profiler_pop(rs);
                 }
                 else
                 {
@@ -541,60 +856,65 @@ r_status_t r_entity_update(r_state_t *rs, r_entity_t *entity, unsigned int diffe
         {
             unsigned int i;
 
-            for (i = 0; i < element_list->object_list.count && R_SUCCEEDED(status); ++i)
+            for (i = 0; i < element_list->zlist.object_list.count && R_SUCCEEDED(status); ++i)
             {
                 /* Assume the entity list is not locked (it shouldn't be when drawing) */
-                r_element_t *const element = (r_element_t*)element_list->object_list.items[i].object_ref.value.object;
+                r_element_t *const element = (r_element_t*)element_list->zlist.object_list.items[i].object_ref.value.object;
 
                 switch (element->element_type)
                 {
                 case R_ELEMENT_TYPE_IMAGE:
                 case R_ELEMENT_TYPE_IMAGE_REGION:
                 case R_ELEMENT_TYPE_TEXT:
+                case R_ELEMENT_TYPE_TILEMAP:
                     /* These elements are static */
                     break;
 
                 case R_ELEMENT_TYPE_ANIMATION:
                     {
-                        /* Add to counter and advance frames, if necessary */
                         r_element_animation_t *const element_animation = (r_element_animation_t*)element;
                         r_animation_t *const animation = (r_animation_t*)element->image.value.object;
 
                         if (animation != NULL && animation->frames.count > 0)
                         {
-                            element_animation->frame_ms += difference_ms;
-
-                            while (element_animation->frame_index < animation->frames.count - 1 || ((animation->loop || animation->transient) && element_animation->frame_index < animation->frames.count))
+                            /* Synchronized elements follow the shared clock; others accumulate their own time (wrapped or clamped to the animation's duration) */
+                            if (!element_animation->synchronized)
                             {
-                                r_animation_frame_t *const frame = r_animation_frame_list_get_index(rs, &animation->frames, element_animation->frame_index);
+                                element_animation->elapsed_ms += difference_ms;
 
-                                if (element_animation->frame_ms < frame->ms)
+                                if (animation->loop && animation->duration_ms > 0)
                                 {
-                                    break;
+                                    element_animation->elapsed_ms = (r_real_t)fmod(element_animation->elapsed_ms, animation->duration_ms);
                                 }
-                                else
+                                else if (element_animation->elapsed_ms > animation->duration_ms)
                                 {
-                                    /* Advance to next frame */
-                                    element_animation->frame_ms -= frame->ms;
-                                    element_animation->frame_index++;
-
-                                    if (element_animation->frame_index == animation->frames.count)
-                                    {
-                                        /* Reached the end of the animation */
-                                        if (animation->loop && frame->ms > 0)
-                                        {
-                                            element_animation->frame_index = 0;
-                                        }
-                                        else if (animation->transient)
-                                        {
-                                            /* Transient and complete; remove this element from the list (and counter the loop increment) */
-                                            r_element_list_remove_index(rs, (r_object_t*)entity, element_list, i);
-                                            --i;
-                                            break;
-                                        }
-                                    }
+                                    element_animation->elapsed_ms = animation->duration_ms;
                                 }
                             }
+
+                            if (animation->transient && r_element_animation_get_elapsed_ms(rs, element_animation) >= animation->duration_ms)
+                            {
+                                /* Transient and complete; remove this element from the list (and counter the loop increment) */
+                                r_element_list_remove_index(rs, (r_object_t*)entity, element_list, i);
+                                --i;
+                            }
+                        }
+                    }
+                    break;
+
+                case R_ELEMENT_TYPE_PARTICLE_EMITTER:
+                    {
+                        /* Particles are simulated natively, in layer coordinates (nothing is emitted while the entity is degenerate) */
+                        r_transform2d_t *transform = NULL;
+
+                        if (!r_entity_is_degenerate(entity))
+                        {
+                            status = r_entity_get_absolute_transform(rs, entity, &transform);
+                        }
+
+                        if (R_SUCCEEDED(status))
+                        {
+                            status = r_element_particle_emitter_update(rs, (r_element_particle_emitter_t*)element, transform, difference_ms);
                         }
                     }
                     break;
@@ -54,9 +54,24 @@ typedef struct _r_entity
     r_vector2d_t        bound_max;
     unsigned int        bounds_version;
 
+    /* Entities that are asleep or have no update function, animated elements, or active children are skipped during updates (cached until the entity or a descendant changes, or the state's activity version changes) */
+    r_boolean_t         sleeping;
+    r_boolean_t         active;
+    r_boolean_t         active_dirty;
+    unsigned int        active_version;
+
     /* The "version" indicates when the entity's position, scale, or rotation (i.e. transformation) have changed */
     unsigned int        version;
 
+    /* Transformation from before the entity was first changed during the given update step (used for interpolation) */
+    r_boolean_t         previous_valid;
+    unsigned int        previous_step;
+    r_real_t            previous_x;
+    r_real_t            previous_y;
+    r_real_t            previous_width;
+    r_real_t            previous_height;
+    r_real_t            previous_angle;
+
     r_real_t            x;
     r_real_t            y;
     r_real_t            z;
@@ -65,12 +80,18 @@ typedef struct _r_entity
     r_real_t            angle;
     r_object_ref_t      color;
 
+    /* Subtrees can be drawn from a cached bitmap that is only rendered again when the subtree changes */
+    r_boolean_t         cache_as_bitmap;
+    void                *bitmap_cache;
+
     r_real_t            order;
     unsigned int        group;
 } r_entity_t;
 
 extern r_status_t r_entity_setup(r_state_t *rs);
 
+extern void r_entity_invalidate_activity(r_entity_t *entity);
+extern r_boolean_t r_entity_is_active(r_state_t *rs, r_entity_t *entity);
 extern r_status_t r_entity_update(r_state_t *rs, r_entity_t *entity, unsigned int difference_ms);
 extern r_status_t r_entity_lock(r_state_t *rs, r_entity_t *entity);
 extern r_status_t r_entity_unlock(r_state_t *rs, r_entity_t *entity);
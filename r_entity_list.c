@@ -92,7 +92,11 @@ r_status_t r_entity_list_update(r_state_t *rs, r_entity_list_t *entity_list, uns
             {
                 r_entity_t *entity = (r_entity_t*)entity_list->object_list.items[i].object_ref.value.object;
 
-                status = r_entity_update(rs, entity, difference_ms);
+                /* Skip sleeping entities and static subtrees */
+                if (r_entity_is_active(rs, entity))
+                {
+                    status = r_entity_update(rs, entity, difference_ms);
+                }
             }
         }
     }
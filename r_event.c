@@ -33,6 +33,13 @@ THE SOFTWARE.
 #include "r_layer_stack.h"
 #include "r_audio.h"
 #include "r_capture.h"
+#include "r_profiler.h"
+#include "r_script_profiler.h"
+#include "r_replay.h"
+#include "r_pacing.h"
+
+/* Simulated frame period used when headless for layers that only update on events */
+#define R_EVENT_HEADLESS_FRAME_PERIOD_MS    16
 
 typedef struct {
     int             joystick_count;
@@ -75,14 +82,23 @@ const char *mouse_button_names[] = {
     "mb31"
 };
 
-R_INLINE r_status_t r_event_get_current_time(unsigned int *current_time_ms)
+R_INLINE r_status_t r_event_get_current_time(r_state_t *rs, unsigned int *current_time_ms)
 {
     r_status_t status = (current_time_ms != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
 
     if (R_SUCCEEDED(status))
     {
-        *current_time_ms = (unsigned int)(SDL_GetTicks() % R_REAL_EXACT_INTEGER_MAX);
+        /* Use the simulated clock when headless */
+        int time_ms = (int)((rs->headless ? rs->headless_time_ms : SDL_GetTicks()) % R_REAL_EXACT_INTEGER_MAX);
+
+        /* Record (or replay) the time so that layer updates see the same time differences during playback */
+        if (rs->replay != NULL)
+        {
+            status = r_replay_sample(rs, (r_replay_t*)rs->replay, R_REPLAY_PACKET_TIME, &time_ms, NULL);
+        }
+
+        *current_time_ms = (unsigned int)time_ms;
     }
 
     return status;
@@ -123,7 +139,7 @@ static r_status_t r_event_detect_active_layer(r_state_t *rs, r_layer_t **layer,
         if (*layer != *last_layer && *layer != NULL)
         {
             /* New active layer; set last update time to the current time */
-            status = r_event_get_current_time(&((*layer)->last_update_ms));
+            status = r_event_get_current_time(rs, &((*layer)->last_update_ms));
 
             if (R_SUCCEEDED(status))
             {
@@ -383,6 +399,12 @@ static r_status_t r_event_handle_event(r_state_t *rs, r_layer_t *layer, SDL_Even
     r_status_t status = (rs != NULL && layer != NULL && ev != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
 
+    /* Record the event, if necessary */
+    if (R_SUCCEEDED(status) && rs->replay != NULL)
+    {
+        status = r_replay_record_event(rs, (r_replay_t*)rs->replay, ev);
+    }
+
     if (R_SUCCEEDED(status))
     {
         switch (ev->type)
@@ -410,6 +432,19 @@ static r_status_t r_event_handle_event(r_state_t *rs, r_layer_t *layer, SDL_Even
 
                 rs->capture = capture;
             }
+            else if (ev->key.keysym.sym == SDLK_F8 && ev->key.state == SDL_PRESSED)
+            {
+                /* Toggle the script profiler, writing out results when it is stopped */
+                if (rs->script_profiler == NULL)
+                {
+                    status = r_script_profiler_start(rs, R_SCRIPT_PROFILER_DEFAULT_INTERVAL);
+                }
+                else
+                {
+                    status = r_script_profiler_dump(rs, R_SCRIPT_PROFILER_DEFAULT_FILE_NAME);
+                    r_script_profiler_stop(rs);
+                }
+            }
             else
 #endif
             {
@@ -460,7 +495,16 @@ static int l_Mouse_getPosition(lua_State *ls)
         r_vector2d_t v;
 
         SDL_GetMouseState(&x, &y);
-        status = r_event_pixels_to_coordinates(rs, x, y, &v);
+
+        if (rs->replay != NULL)
+        {
+            status = r_replay_sample(rs, (r_replay_t*)rs->replay, R_REPLAY_PACKET_MOUSE, &x, &y);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_event_pixels_to_coordinates(rs, x, y, &v);
+        }
 
         if (R_SUCCEEDED(status))
         {
@@ -488,8 +532,8 @@ r_status_t r_event_start(r_state_t *rs)
 
     if (R_SUCCEEDED(status))
     {
-        /* Open all available joysticks */
-        int joystick_count = SDL_NumJoysticks();
+        /* Open all available joysticks (the joystick subsystem is not initialized when headless) */
+        int joystick_count = rs->headless ? 0 : SDL_NumJoysticks();
         r_event_state_t *event_state = (r_event_state_t*)malloc(sizeof(r_event_state_t) + joystick_count * sizeof(SDL_Joystick*));
 
         status = (event_state != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
@@ -498,7 +542,7 @@ r_status_t r_event_start(r_state_t *rs)
         {
             int i;
 
-            event_state->joystick_count = SDL_NumJoysticks();
+            event_state->joystick_count = joystick_count;
 
             for (i = 0; i < event_state->joystick_count && R_SUCCEEDED(status); ++i)
             {
@@ -509,7 +553,11 @@ r_status_t r_event_start(r_state_t *rs)
             if (R_SUCCEEDED(status))
             {
                 rs->event_state = (void*)event_state;
-                status = (SDL_JoystickEventState(SDL_ENABLE) == SDL_ENABLE) ? R_SUCCESS : R_FAILURE;
+
+                if (!rs->headless)
+                {
+                    status = (SDL_JoystickEventState(SDL_ENABLE) == SDL_ENABLE) ? R_SUCCESS : R_FAILURE;
+                }
             }
             
             if (R_FAILED(status))
@@ -524,6 +572,11 @@ r_status_t r_event_start(r_state_t *rs)
         }
     }
 
+    if (R_SUCCEEDED(status))
+    {
+        status = r_pacing_start(rs);
+    }
+
     return status;
 }
 
@@ -545,6 +598,15 @@ void r_event_end(r_state_t *rs)
         rs->event_state = NULL;
     }
 
+    /* Stop profiling, if necessary */
+    r_profiler_stop(rs);
+    r_script_profiler_stop(rs);
+
+    /* Finish recording or playback, if necessary */
+    r_replay_stop(rs);
+
+    r_pacing_end(rs);
+
     /* Revert Unicode translation */
     SDL_EnableUNICODE(0);
 }
@@ -573,12 +635,129 @@ r_status_t r_event_setup(r_state_t *rs)
     return status;
 }
 
+R_INLINE r_boolean_t r_event_is_replaying(r_state_t *rs)
+{
+    return (rs->replay != NULL && ((r_replay_t*)rs->replay)->mode == R_REPLAY_MODE_PLAY) ? R_TRUE : R_FALSE;
+}
+
+static r_status_t r_event_poll(r_state_t *rs, SDL_Event *ev, r_boolean_t *more)
+{
+    r_status_t status = R_SUCCESS;
+
+    if (r_event_is_replaying(rs))
+    {
+        /* Live input is ignored during playback (except for requests to quit) */
+        SDL_Event live_ev;
+
+        while (SDL_PollEvent(&live_ev) != 0)
+        {
+            if (live_ev.type == SDL_QUIT)
+            {
+                rs->done = R_TRUE;
+            }
+        }
+
+        status = r_replay_play_event(rs, (r_replay_t*)rs->replay, ev, more);
+    }
+    else
+    {
+        *more = (SDL_PollEvent(ev) != 0) ? R_TRUE : R_FALSE;
+    }
+
+    return status;
+}
+
+static r_status_t r_event_collect_garbage(r_state_t *rs, unsigned int deadline_ms)
+{
+    /* Step the collector until the budget or the frame's idle time is used up (or a cycle completes) */
+    lua_State *ls = rs->script_state;
+    const unsigned int start_time_ms = SDL_GetTicks();
+    const unsigned int end_time_ms = (R_MIN(deadline_ms, start_time_ms + rs->gc_budget_ms));
+    unsigned int current_time_ms = start_time_ms;
+    unsigned int steps = 0;
+    r_boolean_t cycle_completed = R_FALSE;
+
+    while (!cycle_completed && current_time_ms < end_time_ms)
+    {
+        cycle_completed = (lua_gc(ls, LUA_GCSTEP, 0) != 0) ? R_TRUE : R_FALSE;
+        ++steps;
+
+        current_time_ms = SDL_GetTicks();
+    }
+
+    rs->gc_frame_ms = current_time_ms - start_time_ms;
+    rs->gc_frame_steps = steps;
+
+    return R_SUCCESS;
+}
+
+static r_status_t r_event_loop_headless(r_state_t *rs)
+{
+    /* Update layers on a simulated clock as fast as possible (there is no input or frame delay, and frames are only
+     * drawn when rendering offscreen) */
+    r_layer_t *layer = NULL;
+    r_layer_t *last_layer = NULL;
+    unsigned int frame_count = 0;
+    r_status_t status = r_event_detect_active_layer(rs, &layer, &last_layer);
+
+    while (rs->done == R_FALSE && R_SUCCEEDED(status) && (rs->headless_frame_limit == 0 || frame_count < rs->headless_frame_limit))
+    {
+        r_profiler_begin_frame(rs);
+
+        /* Advance the clock by the layer's frame period (or a default period for event-driven layers) */
+        rs->headless_time_ms += (layer->frame_period_ms > 0) ? (unsigned int)layer->frame_period_ms : R_EVENT_HEADLESS_FRAME_PERIOD_MS;
+
+        status = r_layer_update(rs, layer, rs->headless_time_ms % R_REAL_EXACT_INTEGER_MAX);
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_event_detect_active_layer(rs, &layer, &last_layer);
+        }
+
+        if (R_SUCCEEDED(status) && rs->video_mode_set && layer != NULL)
+        {
+            /* Start capturing once there is something to draw, if requested */
+            if (rs->headless_capture && rs->capture == NULL)
+            {
+                r_capture_t *capture = NULL;
+
+                status = r_capture_start(rs, &capture);
+                rs->capture = capture;
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                status = r_video_draw(rs);
+            }
+        }
+
+        r_profiler_end_frame(rs);
+        ++frame_count;
+    }
+
+    /* Frames are captured before the next one is drawn, so save the last frame before stopping the capture */
+    if (rs->capture != NULL)
+    {
+        r_capture_t *capture = (r_capture_t*)rs->capture;
+
+        r_capture_write_video_packet(rs, capture);
+        r_capture_stop(rs, &capture);
+        rs->capture = capture;
+    }
+
+    return status;
+}
+
 r_status_t r_event_loop(r_state_t *rs)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
 
-    if (R_SUCCEEDED(status))
+    if (R_SUCCEEDED(status) && rs->headless)
+    {
+        status = r_event_loop_headless(rs);
+    }
+    else if (R_SUCCEEDED(status))
     {
         r_layer_t *layer = NULL;
         r_layer_t *last_layer = NULL;
@@ -587,20 +766,31 @@ r_status_t r_event_loop(r_state_t *rs)
 
         while (rs->done == R_FALSE && R_SUCCEEDED(status))
         {
-            const unsigned int frame_start_time_ms = SDL_GetTicks();
+            /* Pace frames to the layer's frame period (except during playback) */
+            const double desired_frame_period_ms = (layer->frame_period_ms > 0 && !r_event_is_replaying(rs)) ? (double)layer->frame_period_ms : 0;
+
+            r_pacing_begin_frame(rs, desired_frame_period_ms);
+            r_profiler_begin_frame(rs);
 
-            /* Wait for an event if the frame period is zero or less */
-            if (layer->frame_period_ms <= 0)
+            /* Wait for an event if the frame period is zero or less (playback runs as fast as possible) */
+            if (layer->frame_period_ms <= 0 && !r_event_is_replaying(rs))
             {
+                r_profiler_push(rs, R_PROFILER_PHASE_IDLE);
                 SDL_WaitEvent(NULL);
+                r_profiler_pop(rs);
             }
 
             /* Handle any pending events */
             if (layer != NULL)
             {
                 SDL_Event ev;
+                r_boolean_t more = R_FALSE;
 
-                while (SDL_PollEvent(&ev) != 0 && R_SUCCEEDED(status))
+                r_profiler_push(rs, R_PROFILER_PHASE_EVENTS);
+
+                status = r_event_poll(rs, &ev, &more);
+
+                while (more && R_SUCCEEDED(status))
                 {
                     /* Send all events to this frame's active layer; drop events if the layer changes. This is to avoid
                      * sending multiple layer (and therefore focus)-changing events (e.g. submitting a high score
@@ -613,14 +803,26 @@ r_status_t r_event_loop(r_state_t *rs)
                     {
                         status = r_event_handle_event(rs, layer, &ev);
                     }
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        status = r_event_poll(rs, &ev, &more);
+                    }
                 }
 
+                r_profiler_pop(rs);
+
                 /* Update the layer with the current time */
                 if (R_SUCCEEDED(status))
                 {
-                    const unsigned int current_time_ms = SDL_GetTicks();
+                    unsigned int current_time_ms = 0;
 
-                    status = r_layer_update(rs, layer, current_time_ms);
+                    status = r_event_get_current_time(rs, &current_time_ms);
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        status = r_layer_update(rs, layer, current_time_ms);
+                    }
                 }
             }
 
@@ -639,20 +841,29 @@ r_status_t r_event_loop(r_state_t *rs)
             /* Delay the necessary amount of time */
             if (R_SUCCEEDED(status))
             {
-                /* Delay the necessary amount to achieve desired frame period */
-                const unsigned int frame_end_time_ms = SDL_GetTicks();
-                const int desired_frame_period_ms = (unsigned int)layer->frame_period_ms;
+                rs->gc_frame_ms = 0;
+                rs->gc_frame_steps = 0;
 
-                if (desired_frame_period_ms > 0 && frame_end_time_ms >= frame_start_time_ms)
+                if (desired_frame_period_ms > 0)
                 {
-                    const Uint32 frame_period_ms = frame_end_time_ms - frame_start_time_ms;
+                    const double idle_ms = desired_frame_period_ms - r_pacing_get_frame_time_ms(rs);
 
-                    if (frame_period_ms < ((Uint32)desired_frame_period_ms))
+                    /* Use idle time to collect garbage incrementally (instead of in large, allocation-triggered pauses) */
+                    if (idle_ms >= 1 && rs->gc_budget_ms > 0)
                     {
-                        SDL_Delay(((Uint32)desired_frame_period_ms) - frame_period_ms);
+                        r_profiler_push(rs, R_PROFILER_PHASE_GC);
+                        status = r_event_collect_garbage(rs, SDL_GetTicks() + (unsigned int)idle_ms);
+                        r_profiler_pop(rs);
                     }
+
+                    /* Delay the necessary amount to achieve desired frame period */
+                    r_profiler_push(rs, R_PROFILER_PHASE_IDLE);
+                    r_pacing_wait(rs);
+                    r_profiler_pop(rs);
                 }
             }
+
+            r_profiler_end_frame(rs);
         }
     }
 
@@ -85,7 +85,7 @@ static r_boolean_t r_hash_table_retrieve_entry(r_state_t *rs, r_hash_table_t *ha
 
     while (entry != NULL)
     {
-        if (entry->key == key)
+        if (entry->key == key || (hash_table_def->key_equal != NULL && hash_table_def->key_equal(entry->key, key)))
         {
             found = R_TRUE;
             break;
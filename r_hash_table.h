@@ -25,7 +25,7 @@ THE SOFTWARE.
 
 #include "r_state.h"
 
-/* Hash table from pointer keys to fixed size values */
+/* Hash table from pointer keys to fixed size values (keys are compared by pointer unless a key comparison function is supplied) */
 typedef struct _r_hash_table_entry
 {
     struct _r_hash_table_entry  *next;
@@ -43,6 +43,7 @@ typedef struct
 
 typedef unsigned int (*r_hash_table_key_hash_t)(const void *key);
 typedef r_status_t (*r_hash_table_value_free_t)(r_state_t *rs, void *value);
+typedef r_boolean_t (*r_hash_table_key_equal_t)(const void *a, const void *b);
 
 typedef struct
 {
@@ -51,6 +52,7 @@ typedef struct
     r_real_t                    max_load_factor;
     r_hash_table_key_hash_t     key_hash;
     r_hash_table_value_free_t   value_free;
+    r_hash_table_key_equal_t    key_equal;
 } r_hash_table_def_t;
 
 extern r_status_t r_hash_table_init(r_state_t *rs, r_hash_table_t *hash_table, const r_hash_table_def_t *hash_table_def);
@@ -47,9 +47,34 @@ THE SOFTWARE.
 
 #define R_IMAGE_INTERNAL_INVALID_ID         0xffffffff
 
+/* Images no larger than this (in either dimension) are packed into shared atlas pages */
+#define R_IMAGE_ATLAS_MAX_IMAGE_SIZE        128
+#define R_IMAGE_ATLAS_PAGE_SIZE             1024
+#define R_IMAGE_ATLAS_MAX_PAGES             16
+#define R_IMAGE_ATLAS_PADDING               1
+
 /* Color representation (8-bits per channel, RGBA) */
 typedef unsigned char r_pixel_t[4];
 
+/* Atlas page (free space is tracked as a "skyline" of horizontal segments, ordered by x, that span the page) */
+typedef struct
+{
+    unsigned int    x;
+    unsigned int    y;
+    unsigned int    width;
+} r_image_atlas_node_t;
+
+typedef struct
+{
+    GLuint                  id;
+    unsigned int            size;
+    unsigned int            image_count;
+    unsigned int            node_count;
+    r_image_atlas_node_t    nodes[1];
+} r_image_atlas_page_t;
+
+static r_image_atlas_page_t *r_image_atlas_pages[R_IMAGE_ATLAS_MAX_PAGES] = { NULL };
+
 /* PNG callbacks */
 static void internal_png_error(png_struct *png, const char *str)
 {
@@ -103,6 +128,34 @@ static void internal_png_read(png_struct *png, png_byte *data, png_size_t length
     }
 }
 
+static void r_image_atlas_page_release(r_state_t *rs, unsigned int index)
+{
+    r_image_atlas_page_t *page = r_image_atlas_pages[index];
+
+    /* Pages are freed once all of their images have been freed */
+    if (page != NULL && --page->image_count == 0)
+    {
+        glDeleteTextures(1, &page->id);
+        free(page);
+        r_image_atlas_pages[index] = NULL;
+    }
+}
+
+static void r_image_atlas_free_pages(r_state_t *rs)
+{
+    unsigned int i;
+
+    for (i = 0; i < R_IMAGE_ATLAS_MAX_PAGES; ++i)
+    {
+        if (r_image_atlas_pages[i] != NULL)
+        {
+            glDeleteTextures(1, &r_image_atlas_pages[i]->id);
+            free(r_image_atlas_pages[i]);
+            r_image_atlas_pages[i] = NULL;
+        }
+    }
+}
+
 static r_status_t r_image_free_texture(r_state_t *rs, r_image_t *image)
 {
     if (rs->video_mode_set)
@@ -114,6 +167,10 @@ static r_status_t r_image_free_texture(r_state_t *rs, r_image_t *image)
             image->storage.native.id = R_IMAGE_INTERNAL_INVALID_ID;
             break;
 
+        case R_IMAGE_STORAGE_ATLAS:
+            r_image_atlas_page_release(rs, image->storage.atlas.page);
+            break;
+
         case R_IMAGE_STORAGE_COMPOSITE:
             {
                 /* Free all texturse and the array of elements */
@@ -192,14 +249,27 @@ static unsigned int r_image_get_element_count(unsigned int max_size, unsigned in
     return size / max_size + ((size % max_size != 0) ? 1 : 0);
 }
 
+/* Compute the texture size needed to hold a region of an image (padding is only needed for powers of two) */
+static unsigned int r_image_get_texture_size(r_state_t *rs, unsigned int size)
+{
+    unsigned int texture_size = rs->min_texture_size;
+
+    if (size > rs->min_texture_size)
+    {
+        texture_size = rs->video_npot_textures ? size : r_image_get_next_power_of_two(size);
+    }
+
+    return texture_size;
+}
+
 static r_status_t r_image_create_texture(r_state_t *rs, unsigned int *id_out, unsigned int width, unsigned int height, GLint pixel_format, const unsigned char *pixels)
 {
     r_status_t status = R_SUCCESS;
     GLuint id = 0;
 
-    /* Check to make sure texture dimensions are powers of 2 within allowable range */
+    /* Check to make sure texture dimensions are powers of 2 (unless unnecessary) within allowable range */
     R_ASSERT(width >= rs->min_texture_size && height >= rs->min_texture_size);
-    R_ASSERT((width & (width - 1)) == 0 && (height & (height - 1)) == 0);
+    R_ASSERT(rs->video_npot_textures || ((width & (width - 1)) == 0 && (height & (height - 1)) == 0));
     R_ASSERT(width <= rs->max_texture_size && height <= rs->max_texture_size);
 
     /* Generate a new OpenGL texture ID */
@@ -212,8 +282,10 @@ static r_status_t r_image_create_texture(r_state_t *rs, unsigned int *id_out, un
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-    /* Actually create the texture now */
+    /* Actually create the texture now (rows of textures that aren't powers of two are not necessarily aligned) */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, pixel_format, GL_UNSIGNED_BYTE, (const void*)pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     status = r_glenum_to_status(glGetError());
 
@@ -272,15 +344,266 @@ static r_status_t r_image_create_texture_from_region(r_state_t *rs,
     return r_image_create_texture(rs, id_out, texture_width, texture_height, pixel_format, buffer);
 }
 
+/* Atlas pages are packed using the "skyline" approach: the top edge of the free space is tracked as a list of
+ * horizontal segments and each image is placed where it leaves the lowest (i.e. closest to the top) skyline */
+static unsigned int r_image_atlas_get_page_size(r_state_t *rs)
+{
+    return R_MIN(R_IMAGE_ATLAS_PAGE_SIZE, rs->max_texture_size);
+}
+
+static r_boolean_t r_image_atlas_fit(r_image_atlas_page_t *page, unsigned int index, unsigned int width, unsigned int height, unsigned int *y_out)
+{
+    /* Find the lowest position for the image with its left edge at the start of the given segment */
+    const unsigned int x = page->nodes[index].x;
+    r_boolean_t fits = (x + width <= page->size) ? R_TRUE : R_FALSE;
+    unsigned int y = 0;
+    unsigned int covered = 0;
+    unsigned int i;
+
+    for (i = index; fits && covered < width; ++i)
+    {
+        y = R_MAX(y, page->nodes[i].y);
+        covered += page->nodes[i].width;
+        fits = (y + height <= page->size) ? R_TRUE : R_FALSE;
+    }
+
+    *y_out = y;
+
+    return fits;
+}
+
+static r_boolean_t r_image_atlas_page_find(r_image_atlas_page_t *page, unsigned int width, unsigned int height, unsigned int *index_out, unsigned int *y_out)
+{
+    /* Choose the position that leaves the lowest skyline (breaking ties by the narrowest segment) */
+    r_boolean_t found = R_FALSE;
+    unsigned int best_bottom = 0;
+    unsigned int best_width = 0;
+    unsigned int i;
+
+    for (i = 0; i < page->node_count; ++i)
+    {
+        unsigned int y = 0;
+
+        if (r_image_atlas_fit(page, i, width, height, &y))
+        {
+            const unsigned int bottom = y + height;
+
+            if (!found || bottom < best_bottom || (bottom == best_bottom && page->nodes[i].width < best_width))
+            {
+                found = R_TRUE;
+                best_bottom = bottom;
+                best_width = page->nodes[i].width;
+                *index_out = i;
+                *y_out = y;
+            }
+        }
+    }
+
+    return found;
+}
+
+static void r_image_atlas_page_insert(r_image_atlas_page_t *page, unsigned int index, unsigned int y, unsigned int width, unsigned int height)
+{
+    unsigned int i;
+
+    /* Add a segment for the top of the new image */
+    memmove(&page->nodes[index + 1], &page->nodes[index], (page->node_count - index) * sizeof(r_image_atlas_node_t));
+    page->nodes[index].y = y + height;
+    page->nodes[index].width = width;
+    ++page->node_count;
+
+    /* Shrink (or remove) the segments it covers */
+    for (i = index + 1; i < page->node_count;)
+    {
+        const unsigned int previous_end = page->nodes[i - 1].x + page->nodes[i - 1].width;
+
+        if (page->nodes[i].x < previous_end)
+        {
+            const unsigned int overlap = previous_end - page->nodes[i].x;
+
+            if (page->nodes[i].width <= overlap)
+            {
+                memmove(&page->nodes[i], &page->nodes[i + 1], (page->node_count - i - 1) * sizeof(r_image_atlas_node_t));
+                --page->node_count;
+            }
+            else
+            {
+                page->nodes[i].x += overlap;
+                page->nodes[i].width -= overlap;
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    /* Merge adjacent segments at the same height */
+    for (i = 0; i + 1 < page->node_count;)
+    {
+        if (page->nodes[i].y == page->nodes[i + 1].y)
+        {
+            page->nodes[i].width += page->nodes[i + 1].width;
+            memmove(&page->nodes[i + 1], &page->nodes[i + 2], (page->node_count - i - 2) * sizeof(r_image_atlas_node_t));
+            --page->node_count;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+static r_status_t r_image_atlas_page_create(r_state_t *rs, unsigned int index)
+{
+    const unsigned int size = r_image_atlas_get_page_size(rs);
+    r_image_atlas_page_t *page = (r_image_atlas_page_t*)malloc(sizeof(r_image_atlas_page_t) + size * sizeof(r_image_atlas_node_t));
+    r_status_t status = (page != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+    if (R_SUCCEEDED(status))
+    {
+        /* Create an empty page texture (a single segment spans the top of the page) */
+        status = r_image_create_texture(rs, &page->id, size, size, GL_RGBA, NULL);
+
+        if (R_SUCCEEDED(status))
+        {
+            page->size = size;
+            page->image_count = 0;
+            page->node_count = 1;
+            page->nodes[0].x = 0;
+            page->nodes[0].y = 0;
+            page->nodes[0].width = size;
+
+            r_image_atlas_pages[index] = page;
+        }
+        else
+        {
+            free(page);
+        }
+    }
+
+    return status;
+}
+
+static r_status_t r_image_atlas_add(r_state_t *rs, r_image_t *image, unsigned int width, unsigned int height, GLint pixel_format, unsigned int pixel_size, const unsigned char *pixels, r_boolean_t *added)
+{
+    /* Images are padded by repeating their edges so that filtering doesn't sample neighboring images */
+    const unsigned int padded_width = width + 2 * R_IMAGE_ATLAS_PADDING;
+    const unsigned int padded_height = height + 2 * R_IMAGE_ATLAS_PADDING;
+    r_status_t status = R_SUCCESS;
+    unsigned int page_index = 0;
+    unsigned int node_index = 0;
+    unsigned int x = 0;
+    unsigned int y = 0;
+    r_boolean_t found = R_FALSE;
+    unsigned int i;
+
+    /* Find space in an existing page */
+    for (i = 0; i < R_IMAGE_ATLAS_MAX_PAGES && !found; ++i)
+    {
+        if (r_image_atlas_pages[i] != NULL && r_image_atlas_page_find(r_image_atlas_pages[i], padded_width, padded_height, &node_index, &y))
+        {
+            found = R_TRUE;
+            page_index = i;
+        }
+    }
+
+    /* Otherwise, start a new page (if there are no free page slots, the image isn't added) */
+    for (i = 0; i < R_IMAGE_ATLAS_MAX_PAGES && !found && R_SUCCEEDED(status); ++i)
+    {
+        if (r_image_atlas_pages[i] == NULL)
+        {
+            status = r_image_atlas_page_create(rs, i);
+
+            if (R_SUCCEEDED(status))
+            {
+                found = r_image_atlas_page_find(r_image_atlas_pages[i], padded_width, padded_height, &node_index, &y);
+                page_index = i;
+            }
+        }
+    }
+
+    *added = R_FALSE;
+
+    if (R_SUCCEEDED(status) && found)
+    {
+        unsigned char *buffer = (unsigned char*)malloc(padded_width * padded_height * pixel_size);
+
+        status = (buffer != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_image_atlas_page_t *page = r_image_atlas_pages[page_index];
+            unsigned int j;
+
+            /* Copy the image (and its edges) into the buffer */
+            for (j = 0; j < padded_height; ++j)
+            {
+                const unsigned int source_row = (j < R_IMAGE_ATLAS_PADDING) ? 0 : (R_MIN(j - R_IMAGE_ATLAS_PADDING, height - 1));
+                const unsigned char *source = &pixels[source_row * width * pixel_size];
+                unsigned char *destination = &buffer[j * padded_width * pixel_size];
+
+                memcpy(&destination[R_IMAGE_ATLAS_PADDING * pixel_size], source, width * pixel_size);
+
+                for (i = 0; i < R_IMAGE_ATLAS_PADDING; ++i)
+                {
+                    memcpy(&destination[i * pixel_size], source, pixel_size);
+                    memcpy(&destination[(padded_width - 1 - i) * pixel_size], &source[(width - 1) * pixel_size], pixel_size);
+                }
+            }
+
+            /* Copy the buffer into the page texture (rows are not necessarily aligned) */
+            x = page->nodes[node_index].x;
+            glBindTexture(GL_TEXTURE_2D, page->id);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, padded_width, padded_height, pixel_format, GL_UNSIGNED_BYTE, (const void*)buffer);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+            status = r_glenum_to_status(glGetError());
+
+            if (R_SUCCEEDED(status))
+            {
+                r_image_atlas_page_insert(page, node_index, y, padded_width, padded_height);
+                ++page->image_count;
+
+                image->storage_type = R_IMAGE_STORAGE_ATLAS;
+                image->storage.atlas.id = page->id;
+                image->storage.atlas.page = page_index;
+                image->storage.atlas.u1 = ((r_real_t)(x + R_IMAGE_ATLAS_PADDING)) / page->size;
+                image->storage.atlas.v1 = ((r_real_t)(y + R_IMAGE_ATLAS_PADDING)) / page->size;
+                image->storage.atlas.u2 = ((r_real_t)(x + R_IMAGE_ATLAS_PADDING + width)) / page->size;
+                image->storage.atlas.v2 = ((r_real_t)(y + R_IMAGE_ATLAS_PADDING + height)) / page->size;
+
+                *added = R_TRUE;
+            }
+
+            free(buffer);
+        }
+    }
+
+    return status;
+}
+
 static r_status_t r_image_load_internal(r_state_t *rs, r_image_t *image, unsigned int width, unsigned int height, GLint pixel_format, unsigned int pixel_size, const unsigned char *pixels)
 {
     r_status_t status = R_SUCCESS;
+    r_boolean_t added = R_FALSE;
 
-    /* Check to see if a native OpenGL texture can be used */
-    if (width >= rs->min_texture_size
+    /* Pack small images into an atlas page, if possible (pages must hold at least a few of the largest images) */
+    if (width <= R_IMAGE_ATLAS_MAX_IMAGE_SIZE
+        && height <= R_IMAGE_ATLAS_MAX_IMAGE_SIZE
+        && ((R_MAX(width, height)) + 2 * R_IMAGE_ATLAS_PADDING) * 4 <= r_image_atlas_get_page_size(rs))
+    {
+        status = r_image_atlas_add(rs, image, width, height, pixel_format, pixel_size, pixels, &added);
+    }
+
+    /* Otherwise, check to see if a native OpenGL texture can be used */
+    if (R_SUCCEEDED(status)
+        && !added
+        && width >= rs->min_texture_size
         && height >= rs->min_texture_size
-        && (width & (width - 1)) == 0
-        && (height & (height - 1)) == 0
+        && (rs->video_npot_textures || ((width & (width - 1)) == 0 && (height & (height - 1)) == 0))
         && width <= rs->max_texture_size
         && height <= rs->max_texture_size)
     {
@@ -288,7 +611,7 @@ static r_status_t r_image_load_internal(r_state_t *rs, r_image_t *image, unsigne
         image->storage_type = R_IMAGE_STORAGE_NATIVE;
         status = r_image_create_texture(rs, &image->storage.native.id, width, height, pixel_format, pixels);
     }
-    else
+    else if (R_SUCCEEDED(status) && !added)
     {
         /* Composite texture; figure out how many rows and columns are needed and create a texture for each region.
            Note that the final column/row regions may have a different size than the others (both in terms of the
@@ -303,13 +626,8 @@ static r_status_t r_image_load_internal(r_state_t *rs, r_image_t *image, unsigne
         int index = 0;
 
         /* Allocate buffer for creating element textures */
-        const unsigned int max_texture_width = (columns == 1) ?
-            ((width > rs->min_texture_size) ? r_image_get_next_power_of_two(width) : rs->min_texture_size)
-            : rs->max_texture_size;
-
-        const unsigned int max_texture_height = (rows == 1) ?
-            ((height > rs->min_texture_size) ? r_image_get_next_power_of_two(height) : rs->min_texture_size)
-            : rs->max_texture_size;
+        const unsigned int max_texture_width = (columns == 1) ? r_image_get_texture_size(rs, width) : rs->max_texture_size;
+        const unsigned int max_texture_height = (rows == 1) ? r_image_get_texture_size(rs, height) : rs->max_texture_size;
 
         const unsigned int buffer_pixels = max_texture_width * max_texture_height;
         const unsigned int buffer_size = buffer_pixels * pixel_size;
@@ -337,7 +655,7 @@ static r_status_t r_image_load_internal(r_state_t *rs, r_image_t *image, unsigne
                     if (j == rows - 1)
                     {
                         region_height = height - y1;
-                        texture_height = (region_height > rs->min_texture_size) ? r_image_get_next_power_of_two(region_height) : rs->min_texture_size;
+                        texture_height = r_image_get_texture_size(rs, region_height);
                     }
 
                     for (i = 0, x1 = 0; i < columns && R_SUCCEEDED(status); ++i)
@@ -349,7 +667,7 @@ static r_status_t r_image_load_internal(r_state_t *rs, r_image_t *image, unsigne
                         if (i == columns - 1)
                         {
                             region_width = width - x1;
-                            texture_width = (region_width > rs->min_texture_size) ? r_image_get_next_power_of_two(region_width) : rs->min_texture_size;
+                            texture_width = r_image_get_texture_size(rs, region_width);
                         }
 
                         /* Create the image element's texture */
@@ -573,6 +891,12 @@ static r_status_t r_image_cache_free_textures(r_state_t *rs)
         status = r_image_free_texture(rs, &r_image_cache_default_image);
     }
 
+    /* All atlas pages should have been freed along with their images, but make sure they are rebuilt on reload */
+    if (R_SUCCEEDED(status) && rs->video_mode_set)
+    {
+        r_image_atlas_free_pages(rs);
+    }
+
     return status;
 }
 
@@ -605,9 +929,10 @@ r_status_t r_image_cache_reload(r_state_t *rs)
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
 
-    /* Free all currently-allocated textures */
+    /* Free all currently-allocated textures (cached bitmaps are rendered again when they are next drawn) */
     if (R_SUCCEEDED(status))
     {
+        r_video_bitmap_caches_release(rs);
         status = r_image_cache_free_textures(rs);
     }
 
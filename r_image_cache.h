@@ -29,6 +29,7 @@ THE SOFTWARE.
 typedef enum {
     R_IMAGE_STORAGE_NATIVE,
     R_IMAGE_STORAGE_COMPOSITE,
+    R_IMAGE_STORAGE_ATLAS,
     R_IMAGE_STORAGE_INVALID
 } r_image_storage_type_t;
 
@@ -57,6 +58,16 @@ typedef struct
             unsigned int rows;
             r_image_element_t *elements;
         } composite;
+
+        /* Small images share atlas page textures (the texture coordinates delimit the image within the page) */
+        struct {
+            unsigned int id;
+            unsigned int page;
+            r_real_t u1;
+            r_real_t v1;
+            r_real_t u2;
+            r_real_t v2;
+        } atlas;
     } storage;
 } r_image_t;
 
@@ -32,6 +32,10 @@ THE SOFTWARE.
 #include "r_audio.h"
 #include "r_audio_clip_cache.h"
 #include "r_collision_detector.h"
+#include "r_profiler.h"
+
+/* Cap on fixed updates per frame; if the simulation falls further behind than this, the extra time is dropped */
+#define R_LAYER_DEFAULT_MAX_UPDATES_PER_FRAME   5
 
 /* TODO: These kinds of static variables for global references mean that there can't be more than one instance of the engine running. Fix this and store data in r_state_t. */
 r_object_ref_t r_layer_ref_add_child        = { R_OBJECT_REF_INVALID, { NULL } };
@@ -56,6 +60,9 @@ r_object_field_t r_layer_fields[] = {
     { "joystickAxisMoved",     LUA_TFUNCTION, 0,   offsetof(r_layer_t, joystick_axis_moved),     R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                     NULL, NULL, NULL },
     { "errorOccurred",         LUA_TFUNCTION, 0,   offsetof(r_layer_t, error_occurred),          R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                     NULL, NULL, NULL },
     { "propagateAudio",        LUA_TBOOLEAN,  0,   offsetof(r_layer_t, propagate_audio),         R_TRUE,  R_OBJECT_INIT_OPTIONAL, NULL,                     NULL, NULL, NULL },
+    { "updatePeriodMS",        LUA_TNUMBER,   0,   offsetof(r_layer_t, update_period_ms),        R_TRUE,  R_OBJECT_INIT_EXCLUDED, NULL,                     r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "maxUpdatesPerFrame",    LUA_TNUMBER,   0,   offsetof(r_layer_t, max_updates_per_frame),   R_TRUE,  R_OBJECT_INIT_EXCLUDED, NULL,                     r_object_field_read_unsigned_int, NULL, r_object_field_write_unsigned_int },
+    { "interpolate",           LUA_TBOOLEAN,  0,   offsetof(r_layer_t, interpolate),             R_TRUE,  R_OBJECT_INIT_EXCLUDED, NULL,                     NULL, NULL, NULL },
     { "addChild",              LUA_TFUNCTION, 0,   0,                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_layer_ref_add_child, NULL },
     { "removeChild",           LUA_TFUNCTION, 0,   0,                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_layer_ref_remove_child, NULL },
     { "forEachChild",          LUA_TFUNCTION, 0,   0,                                            R_FALSE, R_OBJECT_INIT_EXCLUDED, NULL, r_object_ref_field_read_global, &r_layer_ref_for_each_child, NULL },
@@ -76,6 +83,11 @@ static r_status_t r_layer_init(r_state_t *rs, r_object_t *object)
     r_status_t status = r_audio_state_init(rs, &layer->audio_state);
 
     layer->frame_period_ms = -1;
+    layer->update_period_ms = 0;
+    layer->max_updates_per_frame = R_LAYER_DEFAULT_MAX_UPDATES_PER_FRAME;
+    layer->accumulated_ms = 0;
+    layer->interpolate = R_TRUE;
+    layer->interpolation = 1;
 
     layer->propagate_audio = R_TRUE;
 
@@ -439,6 +451,38 @@ r_status_t r_layer_setup(r_state_t *rs)
     return status;
 }
 
+static r_status_t r_layer_update_step(r_state_t *rs, r_layer_t *layer, unsigned int difference_ms)
+{
+    r_status_t status = R_SUCCESS;
+
+    /* Entities save their previous transforms (for interpolation) the first time they change in each step */
+    rs->update_step = rs->update_step + 1;
+    rs->animation_clock_ms += difference_ms;
+
+    if (layer->entities_update.object_list.count > 0)
+    {
+        /* First lock all entity lists */
+        r_profiler_push(rs, R_PROFILER_PHASE_LOCKING);
+        status = r_layer_lock(rs, layer);
+        r_profiler_pop(rs);
+
+        if (R_SUCCEEDED(status))
+        {
+            /* Update all entities (script update functions are profiled separately) */
+            r_profiler_push(rs, R_PROFILER_PHASE_ELEMENTS);
+            status = r_entity_list_update(rs, &layer->entities_update, difference_ms);
+            r_profiler_pop(rs);
+
+            /* Unlock all entity lists */
+            r_profiler_push(rs, R_PROFILER_PHASE_LOCKING);
+            r_layer_unlock(rs, layer);
+            r_profiler_pop(rs);
+        }
+    }
+
+    return status;
+}
+
 r_status_t r_layer_update(r_state_t *rs, r_layer_t *layer, unsigned int current_time_ms)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL && layer != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -446,23 +490,38 @@ r_status_t r_layer_update(r_state_t *rs, r_layer_t *layer, unsigned int current_
 
     if (R_SUCCEEDED(status))
     {
-        if (layer->entities_update.object_list.count > 0)
-        {
-            unsigned int difference_ms = 0;
+        unsigned int difference_ms = 0;
 
-            r_event_get_time_difference(current_time_ms, layer->last_update_ms, &difference_ms);
+        r_event_get_time_difference(current_time_ms, layer->last_update_ms, &difference_ms);
 
-            /* First lock all entity lists */
-            status = r_layer_lock(rs, layer);
+        if (layer->update_period_ms > 0)
+        {
+            /* Run as many fixed steps as have elapsed (up to the cap) */
+            const unsigned int max_updates = (R_MAX(layer->max_updates_per_frame, 1));
+            unsigned int updates = 0;
 
-            if (R_SUCCEEDED(status))
+            layer->accumulated_ms += difference_ms;
+
+            while (layer->accumulated_ms >= layer->update_period_ms && updates < max_updates && R_SUCCEEDED(status))
             {
-                /* Update all entities */
-                status = r_entity_list_update(rs, &layer->entities_update, difference_ms);
+                status = r_layer_update_step(rs, layer, layer->update_period_ms);
+                layer->accumulated_ms -= layer->update_period_ms;
+                ++updates;
+            }
 
-                /* Unlock all entity lists */
-                r_layer_unlock(rs, layer);
+            /* Drop time that couldn't be simulated so that a slow frame can't cause ever-longer frames */
+            if (layer->accumulated_ms >= layer->update_period_ms)
+            {
+                layer->accumulated_ms = layer->accumulated_ms % layer->update_period_ms;
             }
+
+            layer->interpolation = ((r_real_t)layer->accumulated_ms) / layer->update_period_ms;
+        }
+        else
+        {
+            status = r_layer_update_step(rs, layer, difference_ms);
+            layer->accumulated_ms = 0;
+            layer->interpolation = 1;
         }
 
         layer->last_update_ms = current_time_ms;
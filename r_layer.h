@@ -56,6 +56,14 @@ typedef struct
     r_object_id_list_t  collision_detectors;
     r_boolean_t         debug_collision_detectors;
 
+    /* Fixed update step (if the period is zero, each frame is a single update using the actual elapsed time). Time
+     * that has not been simulated accumulates between frames and is used to interpolate entity transforms. */
+    unsigned int        update_period_ms;
+    unsigned int        max_updates_per_frame;
+    unsigned int        accumulated_ms;
+    r_boolean_t         interpolate;
+    r_real_t            interpolation;
+
     unsigned int        last_update_ms;
     /* TODO: Should have a reference to parent layer for drawing everything and using parent layer's audio state */
 } r_layer_t;
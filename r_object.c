@@ -27,10 +27,16 @@ THE SOFTWARE.
 #include "r_assert.h"
 #include "r_script.h"
 
-r_object_ref_t r_object_ref_metatable = { R_OBJECT_REF_INVALID, { NULL } };
+/* Mapping from object header (as light userdata) to the metatable shared by all objects using that header */
+r_object_ref_t r_object_ref_metatables = { R_OBJECT_REF_INVALID, { NULL } };
 
-/* (Weak) Mapping from object ID to the actual script value */
+/* Generic bulk field accessors (exposed as methods by object types that support them) */
+r_object_ref_t r_object_ref_set = { R_OBJECT_REF_INVALID, { NULL } };
+r_object_ref_t r_object_ref_get = { R_OBJECT_REF_INVALID, { NULL } };
+
+/* (Weak) Mappings from object ID to the actual script value and to its environment table (IDs are sequential, so these are mostly array lookups) */
 r_object_ref_t r_object_id_to_value = { R_OBJECT_REF_INVALID, { NULL } };
+r_object_ref_t r_object_id_to_environment = { R_OBJECT_REF_INVALID, { NULL } };
 unsigned int r_object_next_id = 1;
 
 static r_status_t r_object_field_read_internal(r_state_t *rs, r_object_t *object, r_object_field_t *field, int object_index)
@@ -108,7 +114,7 @@ static r_status_t r_object_field_write_internal(r_state_t *rs, r_object_t *objec
     return status;
 }
 
-static r_status_t r_object_field_read_write(r_state_t *rs, r_boolean_t read, r_object_t *object, int object_index, int key_index, int value_index)
+static r_status_t r_object_field_read_write(r_state_t *rs, r_boolean_t read, r_object_t *object, int fields_index, int object_index, int key_index, int value_index)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL && object != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
@@ -122,16 +128,11 @@ static r_status_t r_object_field_read_write(r_state_t *rs, r_boolean_t read, r_o
 
         if (R_SUCCEEDED(status))
         {
-            /* Get the object's environment table */
-            int env_index = 0;
+            /* Look up the member in the field table that is shared by all objects of this type */
             int member_index = 0;
 
-            lua_getfenv(ls, object_index);
-            env_index = lua_gettop(ls);
-
-            /* Look up the member in the environment table */
             lua_pushvalue(ls, key_index);
-            lua_rawget(ls, env_index);
+            lua_rawget(ls, fields_index);
             member_index = lua_gettop(ls);
 
             switch (lua_type(ls, member_index))
@@ -162,45 +163,54 @@ static r_status_t r_object_field_read_write(r_state_t *rs, r_boolean_t read, r_o
                 break;
 
             default:
-                if (!read)
                 {
+                    /* Not a built-in field, so fall back to the object's environment table */
+                    int env_index = 0;
+
                     lua_remove(ls, member_index);
+                    lua_getfenv(ls, object_index);
+                    env_index = lua_gettop(ls);
 
-                    if (object->header->extensible)
+                    if (read)
+                    {
+                        lua_pushvalue(ls, key_index);
+                        lua_rawget(ls, env_index);
+                    }
+                    else if (object->header->extensible)
                     {
-                        /* This is not a built-in field, but the object is extensible, so writing is allowed */
+                        /* The object is extensible, so writing is allowed */
                         lua_pushvalue(ls, key_index);
                         lua_pushvalue(ls, value_index);
                         lua_rawset(ls, env_index);
                     }
+
+                    lua_remove(ls, env_index);
                 }
                 break;
             }
-
-            lua_remove(ls, env_index);
         }
     }
 
     return status;
 }
 
-static r_status_t r_object_field_read(r_state_t *rs, r_object_t *object, int object_index, int key_index)
+r_status_t r_object_field_read(r_state_t *rs, r_object_t *object, int fields_index, int object_index, int key_index)
 {
     r_status_t status = R_FAILURE;
     R_SCRIPT_ENTER();
 
-    status = r_object_field_read_write(rs, R_TRUE, object, object_index, key_index, 0);
+    status = r_object_field_read_write(rs, R_TRUE, object, fields_index, object_index, key_index, 0);
     R_SCRIPT_EXIT(1);
 
     return status;
 }
 
-static r_status_t r_object_field_write(r_state_t *rs, r_object_t *object, int object_index, int key_index, int value_index)
+r_status_t r_object_field_write(r_state_t *rs, r_object_t *object, int fields_index, int object_index, int key_index, int value_index)
 {
     r_status_t status = R_FAILURE;
     R_SCRIPT_ENTER();
 
-    status = r_object_field_read_write(rs, R_FALSE, object, object_index, key_index, value_index);
+    status = r_object_field_read_write(rs, R_FALSE, object, fields_index, object_index, key_index, value_index);
     R_SCRIPT_EXIT(0);
 
     return status;
@@ -224,7 +234,8 @@ static int l_Object_metatable_index(lua_State *ls)
         {
             r_object_t *object = (r_object_t*)lua_touserdata(ls, object_index);
 
-            status = r_object_field_read(rs, object, object_index, key_index);
+            /* The field table is the closure's only upvalue */
+            status = r_object_field_read(rs, object, lua_upvalueindex(1), object_index, key_index);
 
             if (status == R_SUCCESS)
             {
@@ -258,7 +269,7 @@ static int l_Object_metatable_newindex(lua_State *ls)
             r_object_t *object = (r_object_t*)lua_touserdata(ls, 1);
             int key_index = 2;
 
-            status = r_object_field_write(rs, object, object_index, key_index, value_index);
+            status = r_object_field_write(rs, object, lua_upvalueindex(1), object_index, key_index, value_index);
         }
     }
 
@@ -288,6 +299,12 @@ static int l_Object_metatable_gc(lua_State *ls)
             {
                 status = object->header->cleanup(rs, object);
             }
+
+            /* Invalidate the environment handle (the value handle is cleared automatically) */
+            lua_rawgeti(ls, LUA_REGISTRYINDEX, r_object_id_to_environment.ref);
+            lua_pushnil(ls);
+            lua_rawseti(ls, -2, (int)object->id);
+            lua_pop(ls, 1);
         }
     }
 
@@ -377,29 +394,209 @@ static r_status_t r_object_setup_environment(r_state_t *rs, r_object_t *object,
     if (R_SUCCEEDED(status))
     {
         lua_State *ls = rs->script_state;
-        r_object_field_t *field = NULL;
-        int env_index = 0;
 
-        /* Create environment table */
+        /* Create environment table (used for references and extension values; fields are shared in the metatable) */
         lua_newtable(ls);
-        env_index = lua_gettop(ls);
+        lua_setfenv(ls, object_index);
+    }
+
+    return status;
+}
+
+static r_status_t r_object_push_metatable(r_state_t *rs, const r_object_header_t *header)
+{
+    r_status_t status = (rs != NULL && rs->script_state != NULL && header != NULL && header->fields != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_SCRIPT_ENTER();
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        status = r_object_ref_push(rs, NULL, &r_object_ref_metatables);
 
-        /* Setup field pointers */
-        /* TODO: Can this be avoided by sharing the field table for each type (similar to how headers are shared)? */
-        for (field = object->header->fields; field->name != NULL; ++field)
+        if (R_SUCCEEDED(status))
         {
-            lua_pushstring(ls, field->name);
-            lua_pushlightuserdata(ls, (void*)field);
-            lua_rawset(ls, env_index);
+            lua_State *ls = rs->script_state;
+            int metatables_index = lua_gettop(ls);
+
+            lua_pushlightuserdata(ls, (void*)header);
+            lua_rawget(ls, metatables_index);
+
+            if (lua_isnil(ls, -1))
+            {
+                /* First object of this type; build the field table and metatable (both are shared by all objects of this type) */
+                const r_object_field_t *field = NULL;
+                int fields_index = 0;
+                int metatable_index = 0;
+
+                lua_pop(ls, 1);
+                lua_newtable(ls);
+                fields_index = lua_gettop(ls);
+
+                for (field = header->fields; field->name != NULL; ++field)
+                {
+                    lua_pushstring(ls, field->name);
+                    lua_pushlightuserdata(ls, (void*)field);
+                    lua_rawset(ls, fields_index);
+                }
+
+                lua_newtable(ls);
+                metatable_index = lua_gettop(ls);
+
+                lua_pushliteral(ls, "__index");
+                lua_pushvalue(ls, fields_index);
+                lua_pushcclosure(ls, l_Object_metatable_index, 1);
+                lua_rawset(ls, metatable_index);
+
+                lua_pushliteral(ls, "__newindex");
+                lua_pushvalue(ls, fields_index);
+                lua_pushcclosure(ls, l_Object_metatable_newindex, 1);
+                lua_rawset(ls, metatable_index);
+
+                lua_pushliteral(ls, "__gc");
+                lua_pushcfunction(ls, l_Object_metatable_gc);
+                lua_rawset(ls, metatable_index);
+
+                /* Keep the field table accessible for bulk field access (see r_object_push_fields) */
+                lua_pushliteral(ls, "__fields");
+                lua_pushvalue(ls, fields_index);
+                lua_rawset(ls, metatable_index);
+
+                lua_remove(ls, fields_index);
+
+                /* Cache the metatable */
+                lua_pushlightuserdata(ls, (void*)header);
+                lua_pushvalue(ls, -2);
+                lua_rawset(ls, metatables_index);
+            }
+
+            lua_remove(ls, metatables_index);
         }
+    }
 
-        /* Set environment table */
-        lua_setfenv(ls, object_index);
+    R_SCRIPT_EXIT(1);
+
+    return status;
+}
+
+r_status_t r_object_push_fields(r_state_t *rs, int object_index)
+{
+    r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_State *ls = rs->script_state;
+
+        status = (lua_type(ls, object_index) == LUA_TUSERDATA && lua_getmetatable(ls, object_index)) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+        if (R_SUCCEEDED(status))
+        {
+            int metatable_index = lua_gettop(ls);
+
+            lua_pushliteral(ls, "__fields");
+            lua_rawget(ls, metatable_index);
+            lua_remove(ls, metatable_index);
+
+            status = (lua_type(ls, -1) == LUA_TTABLE) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+            if (R_FAILED(status))
+            {
+                lua_pop(ls, 1);
+            }
+        }
     }
 
     return status;
 }
 
+/* Writes every key/value pair in a table to the object's fields */
+int l_Object_set(lua_State *ls)
+{
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TUSERDATA, 0 },
+        { LUA_TTABLE, 0 }
+    };
+
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        int object_index = 1;
+        int table_index = 2;
+        r_object_t *object = (r_object_t*)lua_touserdata(ls, object_index);
+
+        status = r_object_push_fields(rs, object_index);
+
+        if (R_SUCCEEDED(status))
+        {
+            int fields_index = lua_gettop(ls);
+
+            lua_pushnil(ls);
+
+            while (R_SUCCEEDED(status) && lua_next(ls, table_index) != 0)
+            {
+                int key_index = lua_gettop(ls) - 1;
+                int value_index = lua_gettop(ls);
+
+                status = r_object_field_write(rs, object, fields_index, object_index, key_index, value_index);
+                lua_pop(ls, 1);
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+/* Returns the values of each named field */
+int l_Object_get(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    int argument_count = lua_gettop(ls);
+    int result_count = 0;
+    r_status_t status = (argument_count >= 1 && lua_type(ls, 1) == LUA_TUSERDATA) ? R_SUCCESS : RS_F_INCORRECT_TYPE;
+
+    if (R_SUCCEEDED(status))
+    {
+        int object_index = 1;
+        r_object_t *object = (r_object_t*)lua_touserdata(ls, object_index);
+
+        status = r_object_push_fields(rs, object_index);
+
+        if (R_SUCCEEDED(status))
+        {
+            int fields_index = lua_gettop(ls);
+            int key_index;
+
+            for (key_index = 2; key_index <= argument_count && R_SUCCEEDED(status); ++key_index)
+            {
+                status = r_object_field_read(rs, object, fields_index, object_index, key_index);
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                /* Remove the field table and arguments, leaving only the values */
+                int i;
+
+                lua_remove(ls, fields_index);
+
+                for (i = argument_count; i >= 1; --i)
+                {
+                    lua_remove(ls, i);
+                }
+
+                result_count = argument_count - 1;
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
 r_status_t r_object_field_read_unsigned_int(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL && object != NULL && field != NULL && value != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -512,7 +709,7 @@ r_status_t r_object_push_new(r_state_t *rs, const r_object_header_t *header, int
             /* Set metatable */
             if (R_SUCCEEDED(status))
             {
-                status = r_object_ref_push(rs, NULL, &r_object_ref_metatable);
+                status = r_object_push_metatable(rs, header);
 
                 if (R_SUCCEEDED(status))
                 {
@@ -520,21 +717,18 @@ r_status_t r_object_push_new(r_state_t *rs, const r_object_header_t *header, int
                 }
             }
 
-            /* Add object value to the ID-to-value table */
+            /* Add object value and environment to the ID-to-value and ID-to-environment tables */
             if (R_SUCCEEDED(status))
             {
-                status = r_object_ref_push(rs, NULL, &r_object_id_to_value);
-
-                if (R_SUCCEEDED(status))
-                {
-                    int table_index = lua_gettop(ls);
-
-                    lua_pushnumber(ls, (lua_Number)(object->id));
-                    lua_pushvalue(ls, object_index);
-                    lua_rawset(ls, table_index);
+                lua_rawgeti(ls, LUA_REGISTRYINDEX, r_object_id_to_value.ref);
+                lua_pushvalue(ls, object_index);
+                lua_rawseti(ls, -2, (int)object->id);
+                lua_pop(ls, 1);
 
-                    lua_pop(ls, 1);
-                }
+                lua_rawgeti(ls, LUA_REGISTRYINDEX, r_object_id_to_environment.ref);
+                lua_getfenv(ls, object_index);
+                lua_rawseti(ls, -2, (int)object->id);
+                lua_pop(ls, 1);
             }
 
             /* Process arguments */
@@ -594,37 +788,36 @@ int l_Object_new(lua_State *ls, const r_object_header_t *header)
     return result_count;
 }
 
-r_status_t r_object_push_by_id(r_state_t *rs, unsigned int id)
+static r_status_t r_object_push_handle(r_state_t *rs, const r_object_ref_t *handles, unsigned int id, int script_type)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
 
     if (R_SUCCEEDED(status))
     {
-        status = r_object_ref_push(rs, NULL, &r_object_id_to_value);
+        lua_State *ls = rs->script_state;
 
-        if (R_SUCCEEDED(status))
-        {
-            lua_State *ls = rs->script_state;
-            int table_index = lua_gettop(ls);
+        R_ASSERT(id != R_OBJECT_ID_INVALID);
+        lua_rawgeti(ls, LUA_REGISTRYINDEX, handles->ref);
+        lua_rawgeti(ls, -1, (int)id);
+        lua_remove(ls, -2);
 
-            R_ASSERT(id != R_OBJECT_ID_INVALID);
-            lua_pushnumber(ls, (lua_Number)id);
-            lua_rawget(ls, table_index);
-            status = (lua_isuserdata(ls, -1)) ? R_SUCCESS : R_F_ADDRESS_NOT_FOUND;
+        status = (lua_type(ls, -1) == script_type) ? R_SUCCESS : R_F_ADDRESS_NOT_FOUND;
 
-            if (R_FAILED(status))
-            {
-                lua_pop(ls, 1);
-            }
-
-            lua_remove(ls, table_index);
+        if (R_FAILED(status))
+        {
+            lua_pop(ls, 1);
         }
     }
 
     return status;
 }
 
+r_status_t r_object_push_by_id(r_state_t *rs, unsigned int id)
+{
+    return r_object_push_handle(rs, &r_object_id_to_value, id, LUA_TUSERDATA);
+}
+
 r_status_t r_object_push(r_state_t *rs, r_object_t *object)
 {
     r_status_t status = R_SUCCESS;
@@ -636,6 +829,17 @@ r_status_t r_object_push(r_state_t *rs, r_object_t *object)
     return status;
 }
 
+r_status_t r_object_push_environment(r_state_t *rs, r_object_t *object)
+{
+    r_status_t status = R_SUCCESS;
+    R_SCRIPT_ENTER();
+
+    status = r_object_push_handle(rs, &r_object_id_to_environment, object->id, LUA_TTABLE);
+    R_SCRIPT_EXIT(1);
+
+    return status;
+}
+
 r_status_t r_object_setup(r_state_t *rs)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -645,32 +849,51 @@ r_status_t r_object_setup(r_state_t *rs)
     if (R_SUCCEEDED(status))
     {
         lua_State *ls = rs->script_state;
-        r_script_node_t object_metatable_nodes[] = {
-            { "__index", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Object_metatable_index },
-            { "__newindex", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Object_metatable_newindex },
-            { "__gc", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Object_metatable_gc },
-            { NULL }
-        };
 
         r_script_node_root_t roots[] = {
-            { 0, &r_object_ref_metatable, { "", R_SCRIPT_NODE_TYPE_TABLE, object_metatable_nodes } },
+            { 0, &r_object_ref_set, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Object_set } },
+            { 0, &r_object_ref_get, { "", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Object_get } },
             { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
         };
 
         status = r_script_register_nodes(rs, roots);
 
+        /* Set up the (initially empty) table of per-type metatables */
         if (R_SUCCEEDED(status))
         {
-            /* Set up a weak reference table from object ID to the actual value */
+            lua_newtable(ls);
+            status = r_object_table_ref_write(rs, NULL, &r_object_ref_metatables, lua_gettop(ls));
+            lua_pop(ls, 1);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            /* Set up weak reference tables from object ID to the actual value and environment (sharing a metatable) */
             lua_newtable(ls);
 
             lua_newtable(ls);
             lua_pushliteral(ls, "__mode");
             lua_pushliteral(ls, "v");
             lua_rawset(ls, -3);
-            lua_setmetatable(ls, -2);
+            lua_pushvalue(ls, -1);
+            lua_setmetatable(ls, -3);
+
+            status = r_object_table_ref_write(rs, NULL, &r_object_id_to_value, lua_gettop(ls) - 1);
+
+            if (R_SUCCEEDED(status))
+            {
+                lua_newtable(ls);
+                lua_insert(ls, -2);
+                lua_setmetatable(ls, -2);
+
+                status = r_object_table_ref_write(rs, NULL, &r_object_id_to_environment, lua_gettop(ls));
+                lua_pop(ls, 1);
+            }
+            else
+            {
+                lua_pop(ls, 1);
+            }
 
-            r_object_table_ref_write(rs, NULL, &r_object_id_to_value, lua_gettop(ls));
             lua_pop(ls, 1);
         }
     }
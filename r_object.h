@@ -104,13 +104,20 @@ extern r_status_t r_object_field_read_unsigned_int(r_state_t *rs, r_object_t *ob
 extern r_status_t r_object_field_write_unsigned_int(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index);
 extern r_status_t r_object_field_write_default(r_state_t *rs, r_object_t *object, const r_object_field_t *field, void *value, int value_index);
 
+extern r_status_t r_object_push_fields(r_state_t *rs, int object_index);
+extern r_status_t r_object_field_read(r_state_t *rs, r_object_t *object, int fields_index, int object_index, int key_index);
+extern r_status_t r_object_field_write(r_state_t *rs, r_object_t *object, int fields_index, int object_index, int key_index, int value_index);
+
 extern r_status_t r_object_push_by_id(r_state_t *rs, unsigned int id);
 extern r_status_t r_object_push(r_state_t *rs, r_object_t *object);
+extern r_status_t r_object_push_environment(r_state_t *rs, r_object_t *object);
 
 extern r_status_t r_object_setup(r_state_t *rs);
 
 extern r_status_t r_object_push_new(r_state_t *rs, const r_object_header_t *header, int argument_count, int *result_count_out, r_object_t **object_out);
 extern int l_Object_new(lua_State *ls, const r_object_header_t *header);
+extern int l_Object_set(lua_State *ls);
+extern int l_Object_get(lua_State *ls);
 
 #endif
 
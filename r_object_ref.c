@@ -45,14 +45,10 @@ r_status_t r_object_ref_push(r_state_t *rs, r_object_t *object, const r_object_r
             if (object != NULL)
             {
                 /* Use the object's environment table */
-                status = r_object_push(rs, object);
+                status = r_object_push_environment(rs, object);
 
                 if (R_SUCCEEDED(status))
                 {
-                    int object_index = lua_gettop(ls);
-
-                    lua_getfenv(ls, object_index);
-                    lua_remove(ls, object_index);
                     ref_table_index = lua_gettop(ls);
                 }
             }
@@ -115,14 +111,10 @@ static r_status_t r_object_ref_write_internal(r_state_t *rs, r_object_t *object,
                 if (object != NULL)
                 {
                     /* Use the object's environment table */
-                    status = r_object_push(rs, object);
+                    status = r_object_push_environment(rs, object);
 
                     if (R_SUCCEEDED(status))
                     {
-                        int object_index = lua_gettop(ls);
-
-                        lua_getfenv(ls, object_index);
-                        lua_remove(ls, object_index);
                         ref_table_index = lua_gettop(ls);
                     }
                 }
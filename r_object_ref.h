@@ -42,6 +42,10 @@ typedef struct
     } value;
 } r_object_ref_t;
 
+/* Generic bulk field accessor methods (see l_Object_set and l_Object_get) */
+extern r_object_ref_t r_object_ref_set;
+extern r_object_ref_t r_object_ref_get;
+
 R_INLINE void r_object_ref_init(r_object_ref_t *object_ref)
 {
     object_ref->ref = R_OBJECT_REF_INVALID;
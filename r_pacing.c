@@ -0,0 +1,263 @@
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <SDL.h>
+#include <lua.h>
+
+#include "r_assert.h"
+#include "r_pacing.h"
+#include "r_platform.h"
+#include "r_script.h"
+
+r_status_t r_pacing_start(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        r_pacing_t *pacing = (r_pacing_t*)malloc(sizeof(r_pacing_t));
+
+        status = (pacing != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            pacing->spin_ms = R_PACING_DEFAULT_SPIN_MS;
+            pacing->frame_start_ms = r_platform_get_time_ms(rs);
+            pacing->target_period_ms = 0;
+
+            rs->pacing = (void*)pacing;
+            r_pacing_reset_statistics(rs);
+        }
+    }
+
+    return status;
+}
+
+void r_pacing_end(r_state_t *rs)
+{
+    if (rs->pacing != NULL)
+    {
+        free(rs->pacing);
+        rs->pacing = NULL;
+    }
+}
+
+void r_pacing_reset_statistics(r_state_t *rs)
+{
+    r_pacing_t *pacing = (r_pacing_t*)rs->pacing;
+
+    if (pacing != NULL)
+    {
+        pacing->frames = 0;
+        pacing->last_period_ms = 0;
+        pacing->mean_period_ms = 0;
+        pacing->last_jitter_ms = 0;
+        pacing->mean_jitter_ms = 0;
+        pacing->max_jitter_ms = 0;
+    }
+}
+
+void r_pacing_begin_frame(r_state_t *rs, double target_period_ms)
+{
+    r_pacing_t *pacing = (r_pacing_t*)rs->pacing;
+
+    if (pacing != NULL)
+    {
+        const double frame_start_ms = r_platform_get_time_ms(rs);
+
+        /* Measure the previous frame if it was paced to the same period (otherwise its period is meaningless) */
+        if (target_period_ms > 0 && target_period_ms == pacing->target_period_ms)
+        {
+            const double period_ms = frame_start_ms - pacing->frame_start_ms;
+            const double jitter_ms = (period_ms >= target_period_ms) ? (period_ms - target_period_ms) : (target_period_ms - period_ms);
+
+            ++pacing->frames;
+            pacing->last_period_ms = period_ms;
+            pacing->mean_period_ms += (period_ms - pacing->mean_period_ms) / pacing->frames;
+            pacing->last_jitter_ms = jitter_ms;
+            pacing->mean_jitter_ms += (jitter_ms - pacing->mean_jitter_ms) / pacing->frames;
+            pacing->max_jitter_ms = (R_MAX(pacing->max_jitter_ms, jitter_ms));
+        }
+
+        pacing->frame_start_ms = frame_start_ms;
+        pacing->target_period_ms = target_period_ms;
+    }
+}
+
+double r_pacing_get_frame_time_ms(r_state_t *rs)
+{
+    r_pacing_t *pacing = (r_pacing_t*)rs->pacing;
+
+    return (pacing != NULL) ? (r_platform_get_time_ms(rs) - pacing->frame_start_ms) : 0;
+}
+
+void r_pacing_wait(r_state_t *rs)
+{
+    r_pacing_t *pacing = (r_pacing_t*)rs->pacing;
+
+    if (pacing != NULL && pacing->target_period_ms > 0)
+    {
+        const double end_ms = pacing->frame_start_ms + pacing->target_period_ms;
+        const double sleep_end_ms = end_ms - pacing->spin_ms;
+        const double current_ms = r_platform_get_time_ms(rs);
+
+        /* Sleep for whole milliseconds, leaving at least the spin time */
+        if (sleep_end_ms > current_ms)
+        {
+            SDL_Delay((Uint32)(sleep_end_ms - current_ms));
+        }
+
+        /* Spin for the remainder (unless buffer swaps are synchronized to the display, in which case the next swap
+         * will wait for the remainder) */
+        if (!rs->video_vsync_active)
+        {
+            while (r_platform_get_time_ms(rs) < end_ms)
+            {
+            }
+        }
+    }
+}
+
+static int l_Pacing_getStatistics(lua_State *ls)
+{
+    /* Returns frame period and jitter statistics (in milliseconds) */
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (rs->pacing != NULL) ? R_SUCCESS : R_F_INVALID_OPERATION;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_pacing_t *pacing = (r_pacing_t*)rs->pacing;
+            int statistics_index = 0;
+
+            lua_newtable(ls);
+            statistics_index = lua_gettop(ls);
+
+            lua_pushliteral(ls, "frames");
+            lua_pushnumber(ls, (lua_Number)pacing->frames);
+            lua_rawset(ls, statistics_index);
+
+            lua_pushliteral(ls, "targetPeriodMS");
+            lua_pushnumber(ls, (lua_Number)pacing->target_period_ms);
+            lua_rawset(ls, statistics_index);
+
+            lua_pushliteral(ls, "lastPeriodMS");
+            lua_pushnumber(ls, (lua_Number)pacing->last_period_ms);
+            lua_rawset(ls, statistics_index);
+
+            lua_pushliteral(ls, "meanPeriodMS");
+            lua_pushnumber(ls, (lua_Number)pacing->mean_period_ms);
+            lua_rawset(ls, statistics_index);
+
+            lua_pushliteral(ls, "lastJitterMS");
+            lua_pushnumber(ls, (lua_Number)pacing->last_jitter_ms);
+            lua_rawset(ls, statistics_index);
+
+            lua_pushliteral(ls, "meanJitterMS");
+            lua_pushnumber(ls, (lua_Number)pacing->mean_jitter_ms);
+            lua_rawset(ls, statistics_index);
+
+            lua_pushliteral(ls, "maxJitterMS");
+            lua_pushnumber(ls, (lua_Number)pacing->max_jitter_ms);
+            lua_rawset(ls, statistics_index);
+
+            lua_insert(ls, 1);
+            result_count = 1;
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Pacing_resetStatistics(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_pacing_reset_statistics(rs);
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Pacing_setSpinTime(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (rs->pacing != NULL) ? R_SUCCESS : R_F_INVALID_OPERATION;
+
+        if (R_SUCCEEDED(status))
+        {
+            const double spin_ms = (double)lua_tonumber(ls, 1);
+
+            ((r_pacing_t*)rs->pacing)->spin_ms = (spin_ms > 0) ? spin_ms : 0;
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+r_status_t r_pacing_setup(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        r_script_node_t pacing_nodes[] = {
+            { "getStatistics",   R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Pacing_getStatistics },
+            { "resetStatistics", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Pacing_resetStatistics },
+            { "setSpinTime",     R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Pacing_setSpinTime },
+            { NULL }
+        };
+
+        r_script_node_root_t roots[] = {
+            { LUA_GLOBALSINDEX, NULL, { "Pacing", R_SCRIPT_NODE_TYPE_TABLE, pacing_nodes } },
+            { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
+        };
+
+        status = r_script_register_nodes(rs, roots);
+    }
+
+    return status;
+}
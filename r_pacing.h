@@ -0,0 +1,63 @@
+#ifndef __R_PACING_H
+#define __R_PACING_H
+
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "r_defs.h"
+#include "r_state.h"
+
+/* Sleeping can overshoot, so the final part of each wait spins on the high-resolution timer instead */
+#define R_PACING_DEFAULT_SPIN_MS    2.0
+
+/* Frame pacing state and jitter statistics (jitter is the difference between a frame's period and the target period) */
+typedef struct
+{
+    double          spin_ms;
+
+    /* Current frame */
+    double          frame_start_ms;
+    double          target_period_ms;
+
+    /* Statistics (only frames that follow a frame with the same, positive target period are measured) */
+    unsigned int    frames;
+    double          last_period_ms;
+    double          mean_period_ms;
+    double          last_jitter_ms;
+    double          mean_jitter_ms;
+    double          max_jitter_ms;
+} r_pacing_t;
+
+extern r_status_t r_pacing_start(r_state_t *rs);
+extern void r_pacing_end(r_state_t *rs);
+extern r_status_t r_pacing_setup(r_state_t *rs);
+
+extern void r_pacing_reset_statistics(r_state_t *rs);
+
+/* Marks the start of a frame (a target period of zero or less means the frame is not paced) */
+extern void r_pacing_begin_frame(r_state_t *rs, double target_period_ms);
+extern double r_pacing_get_frame_time_ms(r_state_t *rs);
+
+/* Waits until the end of the current frame's target period (sleeping and then spinning) */
+extern void r_pacing_wait(r_state_t *rs);
+
+#endif
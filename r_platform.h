@@ -34,4 +34,7 @@ extern r_status_t r_platform_setup_output(r_state_t *rs, const char *user_dir);
 extern r_status_t r_platform_application_allocate_user_dir(r_state_t *rs, const char *application, char **user_dir);
 extern r_status_t r_platform_application_allocate_data_dirs(r_state_t *rs, const char *application, const char *data_dir_override, char ***data_dirs);
 
+/* High-resolution timer (in milliseconds, relative to an arbitrary starting point) */
+extern double r_platform_get_time_ms(r_state_t *rs);
+
 #endif
@@ -23,7 +23,9 @@ THE SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
@@ -167,3 +169,24 @@ r_status_t r_platform_application_allocate_data_dirs(r_state_t *rs, const char *
     return status;
 }
 
+
+double r_platform_get_time_ms(r_state_t *rs)
+{
+#ifdef CLOCK_MONOTONIC
+    /* Prefer the monotonic clock (it has nanosecond resolution and is not affected by changes to the system time) */
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    {
+        return ((double)ts.tv_sec) * 1000.0 + ((double)ts.tv_nsec) / 1000000.0;
+    }
+    else
+#endif
+    {
+        struct timeval tv;
+
+        gettimeofday(&tv, NULL);
+
+        return ((double)tv.tv_sec) * 1000.0 + ((double)tv.tv_usec) / 1000.0;
+    }
+}
@@ -144,3 +144,14 @@ r_status_t r_platform_application_allocate_data_dirs(r_state_t *rs, const char *
 
     return status;
 }
+
+double r_platform_get_time_ms(r_state_t *rs)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return ((double)counter.QuadPart) * 1000.0 / ((double)frequency.QuadPart);
+}
@@ -0,0 +1,500 @@
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+
+#include "r_assert.h"
+#include "r_profiler.h"
+#include "r_platform.h"
+#include "r_script.h"
+#include "r_string.h"
+#include "r_file_internal.h"
+
+#define R_PROFILER_MAX_LINE_LENGTH  512
+
+const char *r_profiler_phase_names[] = {
+    "other",
+    "events",
+    "script",
+    "elements",
+    "locking",
+    "collision",
+    "draw",
+    "swap",
+    "capture",
+    "gc",
+    "idle"
+};
+
+r_status_t r_profiler_start(r_state_t *rs, unsigned int frame_count)
+{
+    r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (frame_count > 0) ? R_SUCCESS : R_F_INVALID_ARGUMENT;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_profiler_t *profiler = (r_profiler_t*)malloc(sizeof(r_profiler_t));
+
+            status = (profiler != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+            if (R_SUCCEEDED(status))
+            {
+                profiler->frames = (r_profiler_frame_t*)malloc(frame_count * sizeof(r_profiler_frame_t));
+                status = (profiler->frames != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+                if (R_SUCCEEDED(status))
+                {
+                    /* Replace any existing profiler (but keep the overlay setting) */
+                    profiler->overlay = R_FALSE;
+
+                    if (rs->profiler != NULL)
+                    {
+                        profiler->overlay = ((r_profiler_t*)rs->profiler)->overlay;
+                        r_profiler_stop(rs);
+                    }
+
+                    profiler->frame_count = frame_count;
+                    profiler->next_frame = 0;
+                    profiler->recorded_frames = 0;
+                    profiler->origin_ms = r_platform_get_time_ms(rs);
+
+                    /* Note that the profiler may be started in the middle of a frame */
+                    r_profiler_begin_frame_internal(rs, profiler);
+
+                    rs->profiler = (void*)profiler;
+                }
+                else
+                {
+                    free(profiler);
+                }
+            }
+        }
+    }
+
+    return status;
+}
+
+r_status_t r_profiler_stop(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status) && rs->profiler != NULL)
+    {
+        r_profiler_t *profiler = (r_profiler_t*)rs->profiler;
+
+        free(profiler->frames);
+        free(profiler);
+        rs->profiler = NULL;
+    }
+
+    return status;
+}
+
+r_profiler_frame_t *r_profiler_get_frame(r_state_t *rs, r_profiler_t *profiler, unsigned int index)
+{
+    R_ASSERT(index < profiler->recorded_frames);
+
+    return &profiler->frames[(profiler->next_frame + profiler->frame_count - profiler->recorded_frames + index) % profiler->frame_count];
+}
+
+static void r_profiler_charge(r_state_t *rs, r_profiler_t *profiler)
+{
+    /* Attribute time since the last transition to the innermost phase */
+    const double current_ms = r_platform_get_time_ms(rs);
+    const r_profiler_phase_t phase = (profiler->depth > 0) ? profiler->phases[(R_MIN(profiler->depth, R_PROFILER_MAX_DEPTH)) - 1] : R_PROFILER_PHASE_OTHER;
+
+    profiler->current.phase_ms[phase] += current_ms - profiler->last_ms;
+    profiler->last_ms = current_ms;
+}
+
+void r_profiler_begin_frame_internal(r_state_t *rs, r_profiler_t *profiler)
+{
+    int i;
+
+    profiler->last_ms = r_platform_get_time_ms(rs);
+    profiler->depth = 0;
+    profiler->current.start_ms = profiler->last_ms - profiler->origin_ms;
+    profiler->current.total_ms = 0;
+
+    for (i = 0; i < R_PROFILER_PHASE_MAX; ++i)
+    {
+        profiler->current.phase_ms[i] = 0;
+    }
+}
+
+void r_profiler_end_frame_internal(r_state_t *rs, r_profiler_t *profiler)
+{
+    r_profiler_charge(rs, profiler);
+
+    profiler->current.total_ms = profiler->last_ms - profiler->origin_ms - profiler->current.start_ms;
+    profiler->frames[profiler->next_frame] = profiler->current;
+    profiler->next_frame = (profiler->next_frame + 1) % profiler->frame_count;
+
+    if (profiler->recorded_frames < profiler->frame_count)
+    {
+        ++profiler->recorded_frames;
+    }
+}
+
+void r_profiler_push_internal(r_state_t *rs, r_profiler_t *profiler, r_profiler_phase_t phase)
+{
+    r_profiler_charge(rs, profiler);
+
+    /* Phases nested too deeply are attributed to the deepest recorded phase */
+    if (profiler->depth < R_PROFILER_MAX_DEPTH)
+    {
+        profiler->phases[profiler->depth] = phase;
+    }
+
+    ++profiler->depth;
+}
+
+void r_profiler_pop_internal(r_state_t *rs, r_profiler_t *profiler)
+{
+    /* Unbalanced pops are ignored (e.g. if the profiler was started inside a phase) */
+    if (profiler->depth > 0)
+    {
+        r_profiler_charge(rs, profiler);
+        --profiler->depth;
+    }
+}
+
+static int l_Profiler_start(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments_with_optional(rs, 0, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        unsigned int frame_count = R_PROFILER_DEFAULT_FRAME_COUNT;
+
+        if (lua_gettop(ls) >= 1)
+        {
+            frame_count = (lua_tonumber(ls, 1) >= 1) ? (unsigned int)lua_tonumber(ls, 1) : 1;
+        }
+
+        status = r_profiler_start(rs, frame_count);
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Profiler_stop(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        status = r_profiler_stop(rs);
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Profiler_isRunning(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushboolean(ls, (rs->profiler != NULL) ? 1 : 0);
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Profiler_setOverlay(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TBOOLEAN, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (rs->profiler != NULL) ? R_SUCCESS : R_F_INVALID_OPERATION;
+
+        if (R_SUCCEEDED(status))
+        {
+            ((r_profiler_t*)rs->profiler)->overlay = lua_toboolean(ls, 1) ? R_TRUE : R_FALSE;
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Profiler_getFrames(lua_State *ls)
+{
+    /* Returns an array of frames (oldest first), each with start and total times and a time for each phase */
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_profiler_t *profiler = (r_profiler_t*)rs->profiler;
+        int frames_index = 0;
+
+        lua_newtable(ls);
+        frames_index = lua_gettop(ls);
+
+        if (profiler != NULL)
+        {
+            unsigned int i;
+
+            for (i = 0; i < profiler->recorded_frames; ++i)
+            {
+                const r_profiler_frame_t *frame = r_profiler_get_frame(rs, profiler, i);
+                int frame_index = 0;
+                int j;
+
+                lua_newtable(ls);
+                frame_index = lua_gettop(ls);
+
+                lua_pushliteral(ls, "start");
+                lua_pushnumber(ls, (lua_Number)frame->start_ms);
+                lua_rawset(ls, frame_index);
+
+                lua_pushliteral(ls, "total");
+                lua_pushnumber(ls, (lua_Number)frame->total_ms);
+                lua_rawset(ls, frame_index);
+
+                for (j = 0; j < R_PROFILER_PHASE_MAX; ++j)
+                {
+                    lua_pushstring(ls, r_profiler_phase_names[j]);
+                    lua_pushnumber(ls, (lua_Number)frame->phase_ms[j]);
+                    lua_rawset(ls, frame_index);
+                }
+
+                lua_rawseti(ls, frames_index, (int)i + 1);
+            }
+        }
+
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static r_status_t r_profiler_dump_csv(r_state_t *rs, r_profiler_t *profiler, r_file_internal_t *file)
+{
+    char line[R_PROFILER_MAX_LINE_LENGTH];
+    int length = 0;
+    int j;
+    r_status_t status = r_string_format(rs, line, R_ARRAY_SIZE(line), "frame,start,total");
+
+    for (j = 0; j < R_PROFILER_PHASE_MAX && R_SUCCEEDED(status); ++j)
+    {
+        length = (int)strlen(line);
+        status = r_string_format(rs, line + length, R_ARRAY_SIZE(line) - length, ",%s", r_profiler_phase_names[j]);
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        unsigned int i;
+
+        status = r_file_internal_write(rs, file, line);
+
+        for (i = 0; i < profiler->recorded_frames && R_SUCCEEDED(status); ++i)
+        {
+            const r_profiler_frame_t *frame = r_profiler_get_frame(rs, profiler, i);
+
+            status = r_string_format(rs, line, R_ARRAY_SIZE(line), "%u,%.3f,%.3f", i, frame->start_ms, frame->total_ms);
+
+            for (j = 0; j < R_PROFILER_PHASE_MAX && R_SUCCEEDED(status); ++j)
+            {
+                length = (int)strlen(line);
+                status = r_string_format(rs, line + length, R_ARRAY_SIZE(line) - length, ",%.3f", frame->phase_ms[j]);
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                status = r_file_internal_write(rs, file, line);
+            }
+        }
+    }
+
+    return status;
+}
+
+static r_status_t r_profiler_dump_trace(r_state_t *rs, r_profiler_t *profiler, r_file_internal_t *file)
+{
+    /* Chrome trace event format: one complete event per frame plus a counter event with the frame's phase times (in microseconds) */
+    r_status_t status = r_file_internal_write(rs, file, "{\"traceEvents\":[");
+    unsigned int i;
+
+    for (i = 0; i < profiler->recorded_frames && R_SUCCEEDED(status); ++i)
+    {
+        const r_profiler_frame_t *frame = r_profiler_get_frame(rs, profiler, i);
+        char line[R_PROFILER_MAX_LINE_LENGTH];
+        int length = 0;
+        int j;
+
+        status = r_string_format(rs, line, R_ARRAY_SIZE(line), "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.0f,\"dur\":%.0f},", frame->start_ms * 1000, frame->total_ms * 1000);
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_file_internal_write(rs, file, line);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_string_format(rs, line, R_ARRAY_SIZE(line), "{\"name\":\"phases\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.0f,\"args\":{", frame->start_ms * 1000);
+        }
+
+        for (j = 0; j < R_PROFILER_PHASE_MAX && R_SUCCEEDED(status); ++j)
+        {
+            length = (int)strlen(line);
+            status = r_string_format(rs, line + length, R_ARRAY_SIZE(line) - length, "%s\"%s\":%.0f", (j > 0) ? "," : "", r_profiler_phase_names[j], frame->phase_ms[j] * 1000);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            length = (int)strlen(line);
+            status = r_string_format(rs, line + length, R_ARRAY_SIZE(line) - length, "}}%s", (i + 1 < profiler->recorded_frames) ? "," : "");
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_file_internal_write(rs, file, line);
+        }
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        status = r_file_internal_write(rs, file, "]}");
+    }
+
+    return status;
+}
+
+static int l_Profiler_dump(lua_State *ls)
+{
+    /* Writes recorded frames to a file in the user directory, either as CSV (the default) or as a Chrome trace ("trace") */
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TSTRING, 0 },
+        { LUA_TSTRING, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments_with_optional(rs, 1, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        r_profiler_t *profiler = (r_profiler_t*)rs->profiler;
+        const char *format = (lua_gettop(ls) >= 2) ? lua_tostring(ls, 2) : "csv";
+
+        status = (profiler != NULL) ? R_SUCCESS : R_F_INVALID_OPERATION;
+
+        if (R_SUCCEEDED(status))
+        {
+            status = (strcmp(format, "csv") == 0 || strcmp(format, "trace") == 0) ? R_SUCCESS : R_F_INVALID_ARGUMENT;
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            r_file_internal_t file;
+
+            status = r_file_internal_init(rs, &file);
+
+            if (R_SUCCEEDED(status))
+            {
+                status = r_file_internal_open_write(rs, &file, lua_tostring(ls, 1));
+
+                if (R_SUCCEEDED(status))
+                {
+                    if (strcmp(format, "trace") == 0)
+                    {
+                        status = r_profiler_dump_trace(rs, profiler, &file);
+                    }
+                    else
+                    {
+                        status = r_profiler_dump_csv(rs, profiler, &file);
+                    }
+                }
+
+                r_file_internal_cleanup(rs, &file);
+            }
+        }
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+r_status_t r_profiler_setup(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        r_script_node_t profiler_nodes[] = {
+            { "start",      R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Profiler_start },
+            { "stop",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Profiler_stop },
+            { "isRunning",  R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Profiler_isRunning },
+            { "setOverlay", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Profiler_setOverlay },
+            { "getFrames",  R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Profiler_getFrames },
+            { "dump",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Profiler_dump },
+            { NULL }
+        };
+
+        r_script_node_root_t roots[] = {
+            { LUA_GLOBALSINDEX, NULL, { "Profiler", R_SCRIPT_NODE_TYPE_TABLE, profiler_nodes } },
+            { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
+        };
+
+        status = r_script_register_nodes(rs, roots);
+    }
+
+    return status;
+}
@@ -0,0 +1,122 @@
+#ifndef __R_PROFILER_H
+#define __R_PROFILER_H
+
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "r_defs.h"
+#include "r_state.h"
+
+#define R_PROFILER_DEFAULT_FRAME_COUNT  120
+#define R_PROFILER_MAX_DEPTH            16
+
+/* Frame phases (time is attributed to the innermost active phase, so phase times are exclusive) */
+typedef enum
+{
+    R_PROFILER_PHASE_OTHER = 0,
+    R_PROFILER_PHASE_EVENTS,
+    R_PROFILER_PHASE_SCRIPT,
+    R_PROFILER_PHASE_ELEMENTS,
+    R_PROFILER_PHASE_LOCKING,
+    R_PROFILER_PHASE_COLLISION,
+    R_PROFILER_PHASE_DRAW,
+    R_PROFILER_PHASE_SWAP,
+    R_PROFILER_PHASE_CAPTURE,
+    R_PROFILER_PHASE_GC,
+    R_PROFILER_PHASE_IDLE,
+    R_PROFILER_PHASE_MAX
+} r_profiler_phase_t;
+
+typedef struct
+{
+    double                  start_ms;
+    double                  total_ms;
+    double                  phase_ms[R_PROFILER_PHASE_MAX];
+} r_profiler_frame_t;
+
+typedef struct
+{
+    r_boolean_t             overlay;
+
+    /* Current frame */
+    double                  origin_ms;
+    double                  last_ms;
+    unsigned int            depth;
+    r_profiler_phase_t      phases[R_PROFILER_MAX_DEPTH];
+    r_profiler_frame_t      current;
+
+    /* Ring buffer of completed frames */
+    unsigned int            frame_count;
+    unsigned int            next_frame;
+    unsigned int            recorded_frames;
+    r_profiler_frame_t      *frames;
+} r_profiler_t;
+
+extern const char *r_profiler_phase_names[];
+
+extern r_status_t r_profiler_start(r_state_t *rs, unsigned int frame_count);
+extern r_status_t r_profiler_stop(r_state_t *rs);
+
+/* Returns completed frames, oldest first (index must be less than recorded_frames) */
+extern r_profiler_frame_t *r_profiler_get_frame(r_state_t *rs, r_profiler_t *profiler, unsigned int index);
+
+extern void r_profiler_begin_frame_internal(r_state_t *rs, r_profiler_t *profiler);
+extern void r_profiler_end_frame_internal(r_state_t *rs, r_profiler_t *profiler);
+extern void r_profiler_push_internal(r_state_t *rs, r_profiler_t *profiler, r_profiler_phase_t phase);
+extern void r_profiler_pop_internal(r_state_t *rs, r_profiler_t *profiler);
+
+/* These are no-ops unless the profiler is running */
+R_INLINE void r_profiler_begin_frame(r_state_t *rs)
+{
+    if (rs->profiler != NULL)
+    {
+        r_profiler_begin_frame_internal(rs, (r_profiler_t*)rs->profiler);
+    }
+}
+
+R_INLINE void r_profiler_end_frame(r_state_t *rs)
+{
+    if (rs->profiler != NULL)
+    {
+        r_profiler_end_frame_internal(rs, (r_profiler_t*)rs->profiler);
+    }
+}
+
+R_INLINE void r_profiler_push(r_state_t *rs, r_profiler_phase_t phase)
+{
+    if (rs->profiler != NULL)
+    {
+        r_profiler_push_internal(rs, (r_profiler_t*)rs->profiler, phase);
+    }
+}
+
+R_INLINE void r_profiler_pop(r_state_t *rs)
+{
+    if (rs->profiler != NULL)
+    {
+        r_profiler_pop_internal(rs, (r_profiler_t*)rs->profiler);
+    }
+}
+
+extern r_status_t r_profiler_setup(r_state_t *rs);
+
+#endif
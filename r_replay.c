@@ -0,0 +1,238 @@
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "r_assert.h"
+#include "r_log.h"
+#include "r_replay.h"
+
+#define R_REPLAY_FLUSH_SIZE     4096
+#define R_REPLAY_BUFFER_SIZE    (16 * R_REPLAY_FLUSH_SIZE)
+
+unsigned int r_replay_signature = 0x0e1a7e01;
+
+static r_status_t r_replay_read_next(r_state_t *rs, r_replay_t *replay)
+{
+    replay->next_valid = (PHYSFS_read(replay->file, &replay->next, sizeof(r_replay_packet_t), 1) == 1) ? R_TRUE : R_FALSE;
+
+    return R_SUCCESS;
+}
+
+r_status_t r_replay_start(r_state_t *rs, const char *path, r_replay_mode_t mode)
+{
+    r_status_t status = (rs != NULL && path != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (mode >= 0 && mode < R_REPLAY_MODE_COUNT && rs->replay == NULL) ? R_SUCCESS : R_F_INVALID_ARGUMENT;
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        r_replay_t *replay = (r_replay_t*)malloc(sizeof(r_replay_t));
+
+        status = (replay != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_replay_header_t header = { r_replay_signature, 0 };
+
+            replay->mode = mode;
+            replay->file = NULL;
+            replay->next_valid = R_FALSE;
+
+            if (mode == R_REPLAY_MODE_RECORD)
+            {
+                /* Reseed the random number generator so the seed can be recorded */
+                header.seed = (unsigned int)time(NULL);
+                status = r_stream_async_start(&replay->log, path, R_REPLAY_BUFFER_SIZE, R_REPLAY_FLUSH_SIZE);
+
+                if (R_SUCCEEDED(status))
+                {
+                    status = r_stream_async_write(&replay->log, sizeof(r_replay_header_t), &header);
+
+                    if (R_FAILED(status))
+                    {
+                        r_stream_async_stop(&replay->log);
+                    }
+                }
+            }
+            else
+            {
+                replay->file = PHYSFS_openRead(path);
+                status = (replay->file != NULL) ? R_SUCCESS : R_F_NOT_FOUND;
+
+                if (R_SUCCEEDED(status))
+                {
+                    status = (PHYSFS_read(replay->file, &header, sizeof(r_replay_header_t), 1) == 1 && header.signature == r_replay_signature) ? R_SUCCESS : R_F_INVALID_ARGUMENT;
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        status = r_replay_read_next(rs, replay);
+                    }
+
+                    if (R_FAILED(status))
+                    {
+                        PHYSFS_close(replay->file);
+                    }
+                }
+            }
+
+            if (R_SUCCEEDED(status))
+            {
+                srand(header.seed);
+                rs->replay = (void*)replay;
+            }
+            else
+            {
+                r_log_error_format(rs, "Could not %s replay \"%s\" (error code: 0x%08x)", (mode == R_REPLAY_MODE_RECORD) ? "record" : "play", path, status);
+                free(replay);
+            }
+        }
+    }
+
+    return status;
+}
+
+r_status_t r_replay_stop(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status) && rs->replay != NULL)
+    {
+        r_replay_t *replay = (r_replay_t*)rs->replay;
+
+        if (replay->mode == R_REPLAY_MODE_RECORD)
+        {
+            status = r_stream_async_stop(&replay->log);
+        }
+        else
+        {
+            PHYSFS_close(replay->file);
+        }
+
+        free(replay);
+        rs->replay = NULL;
+    }
+
+    return status;
+}
+
+static r_status_t r_replay_finish(r_state_t *rs, r_replay_t *replay)
+{
+    /* Playback is complete, so exit */
+    if (!rs->done)
+    {
+        r_log(rs, "Replay finished");
+        rs->done = R_TRUE;
+    }
+
+    return R_SUCCESS;
+}
+
+r_status_t r_replay_record_event(r_state_t *rs, r_replay_t *replay, SDL_Event *ev)
+{
+    r_status_t status = R_SUCCESS;
+
+    if (replay->mode == R_REPLAY_MODE_RECORD)
+    {
+        r_replay_packet_t packet = { R_REPLAY_PACKET_EVENT, { sizeof(SDL_Event), 0 } };
+
+        status = r_stream_async_write(&replay->log, sizeof(r_replay_packet_t), &packet);
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_stream_async_write(&replay->log, sizeof(SDL_Event), ev);
+        }
+    }
+
+    return status;
+}
+
+r_status_t r_replay_play_event(r_state_t *rs, r_replay_t *replay, SDL_Event *ev, r_boolean_t *more)
+{
+    r_status_t status = R_SUCCESS;
+
+    *more = R_FALSE;
+
+    if (replay->mode == R_REPLAY_MODE_PLAY && replay->next_valid && replay->next.type == R_REPLAY_PACKET_EVENT)
+    {
+        /* Events were recorded by the same build, so they should always be the same size */
+        status = (replay->next.values[0] == sizeof(SDL_Event) && PHYSFS_read(replay->file, ev, sizeof(SDL_Event), 1) == 1) ? R_SUCCESS : R_F_INVALID_ARGUMENT;
+
+        if (R_SUCCEEDED(status))
+        {
+            *more = R_TRUE;
+            status = r_replay_read_next(rs, replay);
+        }
+    }
+
+    return status;
+}
+
+r_status_t r_replay_sample(r_state_t *rs, r_replay_t *replay, r_replay_packet_type_t type, int *value1, int *value2)
+{
+    r_status_t status = R_SUCCESS;
+
+    if (replay->mode == R_REPLAY_MODE_RECORD)
+    {
+        r_replay_packet_t packet;
+
+        packet.type = (unsigned int)type;
+        packet.values[0] = *value1;
+        packet.values[1] = (value2 != NULL) ? *value2 : 0;
+
+        status = r_stream_async_write(&replay->log, sizeof(r_replay_packet_t), &packet);
+    }
+    else if (replay->next_valid)
+    {
+        /* Any difference in the order of samples means the run has diverged from the recording */
+        status = (replay->next.type == (unsigned int)type) ? R_SUCCESS : R_F_INVALID_OPERATION;
+
+        if (R_SUCCEEDED(status))
+        {
+            *value1 = replay->next.values[0];
+
+            if (value2 != NULL)
+            {
+                *value2 = replay->next.values[1];
+            }
+
+            status = r_replay_read_next(rs, replay);
+        }
+        else
+        {
+            r_log_error(rs, "Replay diverged from the recording");
+        }
+    }
+    else
+    {
+        /* Leave the live values in place for the rest of this frame */
+        status = r_replay_finish(rs, replay);
+    }
+
+    return status;
+}
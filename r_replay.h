@@ -0,0 +1,87 @@
+#ifndef __R_REPLAY_H
+#define __R_REPLAY_H
+
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <SDL.h>
+#include <physfs.h>
+
+#include "r_defs.h"
+#include "r_state.h"
+#include "r_stream_async.h"
+
+/* Replays record everything that makes a run nondeterministic (the random seed, SDL events, and clock and mouse
+ * samples) so that the run can be reproduced exactly, e.g. as a benchmark */
+typedef enum
+{
+    R_REPLAY_MODE_RECORD = 0,
+    R_REPLAY_MODE_PLAY,
+    R_REPLAY_MODE_COUNT
+} r_replay_mode_t;
+
+typedef enum
+{
+    R_REPLAY_PACKET_EVENT = 0,  /* Followed by an SDL_Event; values[0] holds its size */
+    R_REPLAY_PACKET_TIME,       /* values[0] is the current time (ms) */
+    R_REPLAY_PACKET_MOUSE,      /* values[0] and values[1] are the mouse position (pixels) */
+    R_REPLAY_PACKET_COUNT
+} r_replay_packet_type_t;
+
+typedef struct
+{
+    unsigned int signature;
+    unsigned int seed;
+} r_replay_header_t;
+
+typedef struct
+{
+    unsigned int type;
+    int values[2];
+} r_replay_packet_t;
+
+typedef struct
+{
+    r_replay_mode_t     mode;
+
+    /* Recording state */
+    r_stream_async_t    log;
+
+    /* Playback state (the next packet is always read ahead) */
+    PHYSFS_file         *file;
+    r_boolean_t         next_valid;
+    r_replay_packet_t   next;
+} r_replay_t;
+
+extern r_status_t r_replay_start(r_state_t *rs, const char *path, r_replay_mode_t mode);
+extern r_status_t r_replay_stop(r_state_t *rs);
+
+/* Records an event that is about to be handled */
+extern r_status_t r_replay_record_event(r_state_t *rs, r_replay_t *replay, SDL_Event *ev);
+
+/* Retrieves the next event to handle during playback (more is R_FALSE once this frame's events have been replayed) */
+extern r_status_t r_replay_play_event(r_state_t *rs, r_replay_t *replay, SDL_Event *ev, r_boolean_t *more);
+
+/* Records (or, during playback, replaces) a sample of nondeterministic values */
+extern r_status_t r_replay_sample(r_state_t *rs, r_replay_t *replay, r_replay_packet_type_t type, int *value1, int *value2);
+
+#endif
@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "r_log.h"
 #include "r_assert.h"
 #include "r_layer_stack.h"
+#include "r_script_profiler.h"
 
 /* Panic function for errors on non-protected calls */
 int l_panic(lua_State *ls)
@@ -92,7 +93,9 @@ static r_status_t r_script_call_internal(r_state_t *rs, int argument_count, int
         lua_State *ls = rs->script_state;
 
         /* TODO: Implement an error handler function and use it here */
+        r_script_profiler_enter(rs);
         status = (lua_pcall(ls, argument_count, result_count, 0) == 0) ? R_SUCCESS : RS_FAILURE;
+        r_script_profiler_leave(rs);
 
         if (R_FAILED(status))
         {
@@ -42,6 +42,9 @@ THE SOFTWARE.
 #include "r_video.h"
 #include "r_event.h"
 #include "r_collision_detector.h"
+#include "r_profiler.h"
+#include "r_script_profiler.h"
+#include "r_pacing.h"
 
 #define R_SCRIPT_DUMP_MAX_INDENT            4
 #define R_SCRIPT_DUMP_INDENT_SIZE           2
@@ -693,10 +696,30 @@ static r_status_t r_script_dump_value(r_state_t *rs, int value_index, int max_de
                 if (max_depth > 0)
                 {
                     /* Dump the object type and all fields */
+                    const r_object_field_t *field = NULL;
                     int env_index = 0;
 
                     r_log_format(rs, "%s%s%s {", (const char*)prefix, (const char*)context, (const char*)r_object_type_names[object->header->type]);
 
+                    for (field = object->header->fields; R_SUCCEEDED(status) && field->name != NULL; ++field)
+                    {
+                        char context[R_SCRIPT_DUMP_MAX_CONTEXT_LENGTH];
+
+                        status = r_string_format(rs, context, R_ARRAY_SIZE(context), "%s = ", field->name);
+
+                        if (R_SUCCEEDED(status))
+                        {
+                            /* Push the field's value and dump it */
+                            lua_pushstring(ls, field->name);
+                            lua_gettable(ls, value_index);
+
+                            status = r_script_dump_value(rs, lua_gettop(ls), max_depth - 1, indentation + 1, context);
+
+                            lua_pop(ls, 1);
+                        }
+                    }
+
+                    /* Dump any extension values from the environment table */
                     lua_getfenv(ls, value_index);
                     env_index = lua_gettop(ls);
                     lua_pushnil(ls);
@@ -714,25 +737,7 @@ static r_status_t r_script_dump_value(r_state_t *rs, int value_index, int max_de
 
                             if (R_SUCCEEDED(status))
                             {
-                                int field_value_index = lua_gettop(ls);
-
-                                switch (lua_type(ls, field_value_index))
-                                {
-                                case LUA_TLIGHTUSERDATA:
-                                    /* Push the field's value and dump it */
-                                    lua_pushvalue(ls, field_name_index);
-                                    lua_gettable(ls, value_index);
-
-                                    status = r_script_dump_value(rs, lua_gettop(ls), max_depth - 1, indentation + 1, context);
-
-                                    lua_pop(ls, 1);
-                                    break;
-
-                                default:
-                                    /* Dump the value directly */
-                                    status = r_script_dump_value(rs, field_value_index, max_depth - 1, indentation + 1, context);
-                                    break;
-                                }
+                                status = r_script_dump_value(rs, lua_gettop(ls), max_depth - 1, indentation + 1, context);
                             }
                         }
 
@@ -825,6 +830,101 @@ static int l_garbageCollect(lua_State *ls)
     return 0;
 }
 
+static int l_GarbageCollector_getBudget(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushnumber(ls, (lua_Number)rs->gc_budget_ms);
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_GarbageCollector_setBudget(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        const lua_Number budget_ms = lua_tonumber(ls, 1);
+
+        rs->gc_budget_ms = (budget_ms > 0) ? (unsigned int)budget_ms : 0;
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_GarbageCollector_setParameter(lua_State *ls, int what)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TNUMBER, 0 }
+    };
+
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        /* Return the previous value */
+        lua_pushnumber(ls, (lua_Number)lua_gc(ls, what, (int)lua_tonumber(ls, 1)));
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_GarbageCollector_setPause(lua_State *ls)
+{
+    return l_GarbageCollector_setParameter(ls, LUA_GCSETPAUSE);
+}
+
+static int l_GarbageCollector_setStepMultiplier(lua_State *ls)
+{
+    return l_GarbageCollector_setParameter(ls, LUA_GCSETSTEPMUL);
+}
+
+static int l_GarbageCollector_getStatistics(lua_State *ls)
+{
+    /* Returns time spent collecting in the last frame, steps taken, and total memory in use (in kilobytes) */
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushnumber(ls, (lua_Number)rs->gc_frame_ms);
+        lua_insert(ls, 1);
+        lua_pushnumber(ls, (lua_Number)rs->gc_frame_steps);
+        lua_insert(ls, 2);
+        lua_pushnumber(ls, (lua_Number)lua_gc(ls, LUA_GCCOUNT, 0));
+        lua_insert(ls, 3);
+        result_count = 3;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
 static r_status_t r_script_string_setup(r_state_t *rs)
 {
     lua_State *ls = rs->script_state;
@@ -986,7 +1086,7 @@ r_status_t r_script_setup(r_state_t *rs)
         /* Setup logging functions */
         status = r_log_register(rs, r_script_log);
 
-        /* Table helper functions */
+        /* Table and garbage collector helper functions */
         if (R_SUCCEEDED(status))
         {
             r_script_node_t table_nodes[] = {
@@ -994,8 +1094,18 @@ r_status_t r_script_setup(r_state_t *rs)
                 { NULL }
             };
 
+            r_script_node_t garbage_collector_nodes[] = {
+                { "getBudget",         R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_GarbageCollector_getBudget },
+                { "setBudget",         R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_GarbageCollector_setBudget },
+                { "setPause",          R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_GarbageCollector_setPause },
+                { "setStepMultiplier", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_GarbageCollector_setStepMultiplier },
+                { "getStatistics",     R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_GarbageCollector_getStatistics },
+                { NULL }
+            };
+
             r_script_node_root_t roots[] = {
                 { LUA_GLOBALSINDEX, NULL, { "Table", R_SCRIPT_NODE_TYPE_TABLE, table_nodes } },
+                { LUA_GLOBALSINDEX, NULL, { "GarbageCollector", R_SCRIPT_NODE_TYPE_TABLE, garbage_collector_nodes } },
                 { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
             };
 
@@ -1069,6 +1179,21 @@ r_status_t r_script_setup(r_state_t *rs)
             status = r_collision_detector_setup(rs);
         }
 
+        if (R_SUCCEEDED(status))
+        {
+            status = r_profiler_setup(rs);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_script_profiler_setup(rs);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_pacing_setup(rs);
+        }
+
         if (R_SUCCEEDED(status))
         {
             status = r_script_string_setup(rs);
@@ -0,0 +1,529 @@
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+
+#include "r_assert.h"
+#include "r_script_profiler.h"
+#include "r_platform.h"
+#include "r_script.h"
+#include "r_string.h"
+#include "r_file_internal.h"
+
+#define R_SCRIPT_PROFILER_MAX_LINE_LENGTH   512
+#define R_SCRIPT_PROFILER_MIN_LINES         64
+
+typedef struct
+{
+    r_script_profiler_source_t  *source;
+    int                         line;
+} r_script_profiler_entry_t;
+
+static unsigned int r_script_profiler_source_key_hash(const void *key)
+{
+    /* FNV-1a hash of the source name */
+    const unsigned char *c = (const unsigned char*)key;
+    unsigned int hash = 2166136261U;
+
+    for (; *c != '\0'; c++)
+    {
+        hash = (hash ^ *c) * 16777619U;
+    }
+
+    return hash;
+}
+
+static r_boolean_t r_script_profiler_source_key_equal(const void *a, const void *b)
+{
+    return (strcmp((const char*)a, (const char*)b) == 0) ? R_TRUE : R_FALSE;
+}
+
+static r_status_t r_script_profiler_source_free(r_state_t *rs, void *value)
+{
+    r_script_profiler_source_t *source = *((r_script_profiler_source_t**)value);
+
+    free(source->name);
+    free(source->lines);
+    free(source);
+
+    return R_SUCCESS;
+}
+
+r_hash_table_def_t r_script_profiler_source_def = { sizeof(r_script_profiler_source_t*), 5, 0.75, r_script_profiler_source_key_hash, r_script_profiler_source_free, r_script_profiler_source_key_equal };
+
+static r_status_t r_script_profiler_get_source(r_state_t *rs, r_script_profiler_t *script_profiler, const lua_Debug *ar, r_script_profiler_source_t **source)
+{
+    /* Sources are keyed by the contents of their (short) names since Lua may collect and reuse chunk source strings; each
+     * entry's key is its own copy of the name */
+    r_script_profiler_source_t **source_ptr = NULL;
+    r_status_t status = r_hash_table_retrieve(rs, &script_profiler->sources, ar->short_src, (void**)&source_ptr, &r_script_profiler_source_def);
+
+    if (R_SUCCEEDED(status))
+    {
+        *source = *source_ptr;
+    }
+    else if (status == R_F_NOT_FOUND)
+    {
+        r_script_profiler_source_t *source_internal = (r_script_profiler_source_t*)malloc(sizeof(r_script_profiler_source_t));
+
+        status = (source_internal != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            source_internal->line_count = 0;
+            source_internal->lines = NULL;
+
+            status = r_string_format_allocate(rs, &source_internal->name, LUA_IDSIZE, LUA_IDSIZE, "%s", ar->short_src);
+
+            if (R_SUCCEEDED(status))
+            {
+                status = r_hash_table_insert(rs, &script_profiler->sources, source_internal->name, &source_internal, &r_script_profiler_source_def);
+
+                if (R_SUCCEEDED(status))
+                {
+                    *source = source_internal;
+                }
+                else
+                {
+                    free(source_internal->name);
+                }
+            }
+
+            if (R_FAILED(status))
+            {
+                free(source_internal);
+            }
+        }
+    }
+
+    return status;
+}
+
+static r_status_t r_script_profiler_source_reserve(r_state_t *rs, r_script_profiler_source_t *source, int line)
+{
+    r_status_t status = R_SUCCESS;
+
+    if (line >= source->line_count)
+    {
+        /* Lines are indexed directly by line number */
+        int line_count = (R_MAX(source->line_count, R_SCRIPT_PROFILER_MIN_LINES));
+        r_script_profiler_line_t *lines = NULL;
+
+        while (line_count <= line)
+        {
+            line_count = line_count * 2;
+        }
+
+        lines = (r_script_profiler_line_t*)realloc(source->lines, line_count * sizeof(r_script_profiler_line_t));
+        status = (lines != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            memset(lines + source->line_count, 0, (line_count - source->line_count) * sizeof(r_script_profiler_line_t));
+
+            source->lines = lines;
+            source->line_count = line_count;
+        }
+    }
+
+    return status;
+}
+
+static void r_script_profiler_charge(r_state_t *rs, r_script_profiler_t *script_profiler, r_script_profiler_source_t *source, int line)
+{
+    /* Attribute the time since the last sample (or since entering script code) to the given line */
+    const double current_ms = r_platform_get_time_ms(rs);
+    const double elapsed_ms = current_ms - script_profiler->last_ms;
+
+    if (source != NULL)
+    {
+        source->lines[line].ms += elapsed_ms;
+        script_profiler->total_ms += elapsed_ms;
+    }
+
+    script_profiler->last_ms = current_ms;
+}
+
+static void r_script_profiler_hook(lua_State *ls, lua_Debug *ar)
+{
+    /* Count hook, called every "interval" VM instructions; note that errors can't be reported from here, so failed samples are dropped */
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_script_profiler_t *script_profiler = (r_script_profiler_t*)rs->script_profiler;
+
+    if (script_profiler != NULL && lua_getinfo(ls, "Sl", ar) != 0 && ar->currentline > 0)
+    {
+        r_script_profiler_source_t *source = NULL;
+        r_status_t status = r_script_profiler_get_source(rs, script_profiler, ar, &source);
+
+        if (R_SUCCEEDED(status))
+        {
+            status = r_script_profiler_source_reserve(rs, source, ar->currentline);
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            r_script_profiler_line_t *line = &source->lines[ar->currentline];
+
+            line->function_line = ar->linedefined;
+            line->samples++;
+            script_profiler->total_samples++;
+
+            r_script_profiler_charge(rs, script_profiler, source, ar->currentline);
+
+            script_profiler->last_source = source;
+            script_profiler->last_line = ar->currentline;
+        }
+    }
+}
+
+void r_script_profiler_enter_internal(r_state_t *rs, r_script_profiler_t *script_profiler)
+{
+    if (script_profiler->depth == 0)
+    {
+        /* Don't charge time spent outside of scripts to any line */
+        script_profiler->last_ms = r_platform_get_time_ms(rs);
+        script_profiler->last_source = NULL;
+    }
+
+    script_profiler->depth++;
+}
+
+void r_script_profiler_leave_internal(r_state_t *rs, r_script_profiler_t *script_profiler)
+{
+    /* Note that the profiler may have been started from within a script, so the depth may already be zero */
+    if (script_profiler->depth > 0)
+    {
+        script_profiler->depth--;
+    }
+
+    if (script_profiler->depth == 0)
+    {
+        r_script_profiler_charge(rs, script_profiler, script_profiler->last_source, script_profiler->last_line);
+        script_profiler->last_source = NULL;
+    }
+}
+
+r_status_t r_script_profiler_start(r_state_t *rs, unsigned int interval)
+{
+    r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        status = (interval > 0) ? R_SUCCESS : R_F_INVALID_ARGUMENT;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_script_profiler_t *script_profiler = (r_script_profiler_t*)malloc(sizeof(r_script_profiler_t));
+
+            status = (script_profiler != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+            if (R_SUCCEEDED(status))
+            {
+                status = r_hash_table_init(rs, &script_profiler->sources, &r_script_profiler_source_def);
+
+                if (R_SUCCEEDED(status))
+                {
+                    /* Replace any existing profiler */
+                    r_script_profiler_stop(rs);
+
+                    script_profiler->interval = interval;
+                    script_profiler->depth = 0;
+                    script_profiler->last_ms = r_platform_get_time_ms(rs);
+                    script_profiler->total_ms = 0;
+                    script_profiler->total_samples = 0;
+                    script_profiler->last_source = NULL;
+                    script_profiler->last_line = 0;
+
+                    rs->script_profiler = (void*)script_profiler;
+
+                    /* Note: coroutines created before the profiler was started are not sampled */
+                    lua_sethook(rs->script_state, r_script_profiler_hook, LUA_MASKCOUNT, (int)interval);
+                }
+                else
+                {
+                    free(script_profiler);
+                }
+            }
+        }
+    }
+
+    return status;
+}
+
+r_status_t r_script_profiler_stop(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status) && rs->script_profiler != NULL)
+    {
+        r_script_profiler_t *script_profiler = (r_script_profiler_t*)rs->script_profiler;
+
+        lua_sethook(rs->script_state, NULL, 0, 0);
+
+        status = r_hash_table_cleanup(rs, &script_profiler->sources, &r_script_profiler_source_def);
+        free(script_profiler);
+        rs->script_profiler = NULL;
+    }
+
+    return status;
+}
+
+static int r_script_profiler_entry_compare(const void *a, const void *b)
+{
+    /* Sort by descending time */
+    const r_script_profiler_entry_t *entry_a = (const r_script_profiler_entry_t*)a;
+    const r_script_profiler_entry_t *entry_b = (const r_script_profiler_entry_t*)b;
+    const double ms_a = entry_a->source->lines[entry_a->line].ms;
+    const double ms_b = entry_b->source->lines[entry_b->line].ms;
+
+    return (ms_a < ms_b) ? 1 : ((ms_a > ms_b) ? -1 : 0);
+}
+
+static r_status_t r_script_profiler_get_entries(r_state_t *rs, r_script_profiler_t *script_profiler, r_script_profiler_entry_t **entries, unsigned int *entry_count)
+{
+    /* Collects every sampled line */
+    unsigned int count = 0;
+    r_script_profiler_entry_t *entries_internal = NULL;
+    r_status_t status = R_SUCCESS;
+    int pass;
+
+    for (pass = 0; pass < 2 && R_SUCCEEDED(status); ++pass)
+    {
+        unsigned int i;
+
+        if (pass == 1)
+        {
+            entries_internal = (r_script_profiler_entry_t*)malloc((R_MAX(count, 1)) * sizeof(r_script_profiler_entry_t));
+            status = (entries_internal != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+            count = 0;
+        }
+
+        for (i = 0; i < script_profiler->sources.allocated && R_SUCCEEDED(status); ++i)
+        {
+            r_hash_table_entry_t *hash_table_entry;
+
+            for (hash_table_entry = script_profiler->sources.entries[i]; hash_table_entry != NULL; hash_table_entry = hash_table_entry->next)
+            {
+                r_script_profiler_source_t *source = *((r_script_profiler_source_t**)&hash_table_entry->value);
+                int line;
+
+                for (line = 0; line < source->line_count; ++line)
+                {
+                    if (source->lines[line].samples > 0)
+                    {
+                        if (pass == 1)
+                        {
+                            entries_internal[count].source = source;
+                            entries_internal[count].line = line;
+                        }
+
+                        ++count;
+                    }
+                }
+            }
+        }
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        qsort(entries_internal, count, sizeof(r_script_profiler_entry_t), r_script_profiler_entry_compare);
+
+        *entries = entries_internal;
+        *entry_count = count;
+    }
+
+    return status;
+}
+
+r_status_t r_script_profiler_dump(r_state_t *rs, const char *file_name)
+{
+    /* Writes sampled lines (as CSV, most expensive first) to a file in the user directory */
+    r_status_t status = (rs != NULL && file_name != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        r_script_profiler_t *script_profiler = (r_script_profiler_t*)rs->script_profiler;
+
+        status = (script_profiler != NULL) ? R_SUCCESS : R_F_INVALID_OPERATION;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_script_profiler_entry_t *entries = NULL;
+            unsigned int entry_count = 0;
+
+            status = r_script_profiler_get_entries(rs, script_profiler, &entries, &entry_count);
+
+            if (R_SUCCEEDED(status))
+            {
+                r_file_internal_t file;
+
+                status = r_file_internal_init(rs, &file);
+
+                if (R_SUCCEEDED(status))
+                {
+                    status = r_file_internal_open_write(rs, &file, file_name);
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        unsigned int i;
+
+                        status = r_file_internal_write(rs, &file, "source,line,function,samples,ms,percent");
+
+                        for (i = 0; i < entry_count && R_SUCCEEDED(status); ++i)
+                        {
+                            const r_script_profiler_line_t *line = &entries[i].source->lines[entries[i].line];
+                            char buffer[R_SCRIPT_PROFILER_MAX_LINE_LENGTH];
+
+                            status = r_string_format(rs, buffer, R_ARRAY_SIZE(buffer), "\"%s\",%d,%d,%u,%.3f,%.2f",
+                                                     entries[i].source->name,
+                                                     entries[i].line,
+                                                     line->function_line,
+                                                     line->samples,
+                                                     line->ms,
+                                                     (script_profiler->total_ms > 0) ? line->ms * 100 / script_profiler->total_ms : 0.0);
+
+                            if (R_SUCCEEDED(status))
+                            {
+                                status = r_file_internal_write(rs, &file, buffer);
+                            }
+                        }
+                    }
+
+                    r_file_internal_cleanup(rs, &file);
+                }
+
+                free(entries);
+            }
+        }
+    }
+
+    return status;
+}
+
+static int l_ScriptProfiler_start(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TNUMBER, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments_with_optional(rs, 0, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        unsigned int interval = R_SCRIPT_PROFILER_DEFAULT_INTERVAL;
+
+        if (lua_gettop(ls) >= 1)
+        {
+            interval = (lua_tonumber(ls, 1) >= 1) ? (unsigned int)lua_tonumber(ls, 1) : 1;
+        }
+
+        status = r_script_profiler_start(rs, interval);
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_ScriptProfiler_stop(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        status = r_script_profiler_stop(rs);
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_ScriptProfiler_isRunning(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushboolean(ls, (rs->script_profiler != NULL) ? 1 : 0);
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_ScriptProfiler_dump(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TSTRING, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        status = r_script_profiler_dump(rs, lua_tostring(ls, 1));
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+r_status_t r_script_profiler_setup(r_state_t *rs)
+{
+    r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        r_script_node_t script_profiler_nodes[] = {
+            { "start",      R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_ScriptProfiler_start },
+            { "stop",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_ScriptProfiler_stop },
+            { "isRunning",  R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_ScriptProfiler_isRunning },
+            { "dump",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_ScriptProfiler_dump },
+            { NULL }
+        };
+
+        r_script_node_root_t roots[] = {
+            { LUA_GLOBALSINDEX, NULL, { "ScriptProfiler", R_SCRIPT_NODE_TYPE_TABLE, script_profiler_nodes } },
+            { 0, NULL, { NULL, R_SCRIPT_NODE_TYPE_MAX, NULL, NULL } }
+        };
+
+        status = r_script_register_nodes(rs, roots);
+    }
+
+    return status;
+}
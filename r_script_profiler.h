@@ -0,0 +1,90 @@
+#ifndef __R_SCRIPT_PROFILER_H
+#define __R_SCRIPT_PROFILER_H
+
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "r_defs.h"
+#include "r_state.h"
+#include "r_hash_table.h"
+
+#define R_SCRIPT_PROFILER_DEFAULT_INTERVAL  1000
+#define R_SCRIPT_PROFILER_DEFAULT_FILE_NAME "ScriptProfile.csv"
+
+/* Per-line sample counts and time (the time since the previous sample, including any time spent in C functions, is charged to
+ * whichever line is current when the next sample is taken) */
+typedef struct
+{
+    int                     function_line;
+    unsigned int            samples;
+    double                  ms;
+} r_script_profiler_line_t;
+
+typedef struct
+{
+    char                        *name;
+    int                         line_count;
+    r_script_profiler_line_t    *lines;
+} r_script_profiler_source_t;
+
+typedef struct
+{
+    /* Map from chunk source name to a r_script_profiler_source_t */
+    r_hash_table_t          sources;
+    unsigned int            interval;
+    unsigned int            depth;
+    double                  last_ms;
+    double                  total_ms;
+    unsigned int            total_samples;
+
+    /* Last sampled line (time between the last sample and returning to C is charged to it) */
+    r_script_profiler_source_t  *last_source;
+    int                         last_line;
+} r_script_profiler_t;
+
+extern r_status_t r_script_profiler_start(r_state_t *rs, unsigned int interval);
+extern r_status_t r_script_profiler_stop(r_state_t *rs);
+extern r_status_t r_script_profiler_dump(r_state_t *rs, const char *file_name);
+
+extern void r_script_profiler_enter_internal(r_state_t *rs, r_script_profiler_t *script_profiler);
+extern void r_script_profiler_leave_internal(r_state_t *rs, r_script_profiler_t *script_profiler);
+
+/* These are no-ops unless the script profiler is running; they bracket calls from C into scripts */
+R_INLINE void r_script_profiler_enter(r_state_t *rs)
+{
+    if (rs->script_profiler != NULL)
+    {
+        r_script_profiler_enter_internal(rs, (r_script_profiler_t*)rs->script_profiler);
+    }
+}
+
+R_INLINE void r_script_profiler_leave(r_state_t *rs)
+{
+    if (rs->script_profiler != NULL)
+    {
+        r_script_profiler_leave_internal(rs, (r_script_profiler_t*)rs->script_profiler);
+    }
+}
+
+extern r_status_t r_script_profiler_setup(r_state_t *rs);
+
+#endif
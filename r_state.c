@@ -36,15 +36,25 @@ r_status_t r_state_init(r_state_t *rs, const char *argv0)
         /* Initialize fields */
         rs->argv0 = argv0;
         rs->done = R_FALSE;
+        rs->headless = R_FALSE;
+        rs->headless_frame_limit = 0;
+        rs->headless_time_ms = 0;
+        rs->headless_capture = R_FALSE;
+        rs->video_offscreen = R_FALSE;
+        rs->video_offscreen_state = NULL;
 
         rs->log_file = NULL;
 
         rs->video_mode_set = R_FALSE;
         rs->default_font_path = NULL;
         rs->video_full_featured = R_FALSE;
+        rs->video_npot_textures = R_FALSE;
         rs->min_texture_size = 0;
         rs->max_texture_size = 0;
         r_transform2d_init(&rs->pixels_to_coordinates);
+        rs->video_vsync = R_TRUE;
+        rs->video_vsync_active = R_FALSE;
+        rs->video_pipelined = R_FALSE;
 
         rs->audio = NULL;
         rs->audio_volume = 0;
@@ -52,11 +62,23 @@ r_status_t r_state_init(r_state_t *rs, const char *argv0)
         rs->audio_decoder = NULL;
 
         rs->capture = NULL;
+        rs->profiler = NULL;
+        rs->script_profiler = NULL;
+        rs->replay = NULL;
+        rs->pacing = NULL;
 
         rs->script_state = NULL;
 
         rs->event_state = NULL;
 
+        rs->entity_activity_version = 1;
+        rs->update_step = 1;
+        rs->animation_clock_ms = 0;
+
+        rs->gc_budget_ms = 2;
+        rs->gc_frame_ms = 0;
+        rs->gc_frame_steps = 0;
+
         /* Seed random number generator with current time */
         srand((unsigned int)time(NULL));
     }
@@ -38,6 +38,16 @@ typedef struct _r_state
     /* Exit the application if this is R_TRUE */
     r_boolean_t                     done;
 
+    /* Headless mode (no window, audio device, or input; layers are updated on a simulated clock, and drawn frames can be captured) */
+    r_boolean_t                     headless;
+    unsigned int                    headless_frame_limit;
+    unsigned int                    headless_time_ms;
+    r_boolean_t                     headless_capture;
+
+    /* Headless runs can still draw every frame into an offscreen framebuffer (state is NULL until a mode is set) */
+    r_boolean_t                     video_offscreen;
+    void                            *video_offscreen_state;
+
     /* Log file */
     void                            *log_file;
 
@@ -47,10 +57,18 @@ typedef struct _r_state
     int                             video_width;
     int                             video_height;
     r_boolean_t                     video_full_featured;
+    r_boolean_t                     video_npot_textures;
     unsigned int                    min_texture_size;
     unsigned int                    max_texture_size;
     r_transform2d_t                 pixels_to_coordinates;
 
+    /* Synchronize buffer swaps to the display (requested for the next mode set, and whether it is in effect) */
+    r_boolean_t                     video_vsync;
+    r_boolean_t                     video_vsync_active;
+
+    /* Defer each frame's buffer swap until the next frame is drawn (so the next update overlaps rendering) */
+    r_boolean_t                     video_pipelined;
+
     /* Audio state (note: audio lock must be held when manipulating audio state) */
     void                            *audio;
     unsigned char                   audio_volume;
@@ -60,12 +78,36 @@ typedef struct _r_state
     /* Capture state */
     void                            *capture;
 
+    /* Profiler state (NULL unless profiling) */
+    void                            *profiler;
+    void                            *script_profiler;
+
+    /* Input recording/playback state (NULL unless recording or replaying) */
+    void                            *replay;
+
+    /* Frame pacing state */
+    void                            *pacing;
+
     /* Script state */
     lua_State                       *script_state;
     jmp_buf                         script_error_return_point;
 
     /* Event state */
     void                            *event_state;
+
+    /* Entity state (incremented whenever an animation element changes such that it may need updates) */
+    unsigned int                    entity_activity_version;
+
+    /* Update step (incremented before each layer update step) */
+    unsigned int                    update_step;
+
+    /* Animation clock (advanced by layer updates and shared by synchronized animation elements) */
+    unsigned int                    animation_clock_ms;
+
+    /* Garbage collection (the collector is stepped in idle time at the end of each frame, up to the budget) */
+    unsigned int                    gc_budget_ms;
+    unsigned int                    gc_frame_ms;
+    unsigned int                    gc_frame_steps;
 } r_state_t;
 
 extern r_status_t r_state_init(r_state_t *rs, const char *argv0);
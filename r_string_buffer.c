@@ -105,6 +105,7 @@ static r_status_t r_string_buffer_insert(r_state_t *rs, r_string_buffer_t *strin
                 }
 
                 string_buffer->length = new_length;
+                string_buffer->version = string_buffer->version + 1;
             }
         }
     }
@@ -137,6 +138,8 @@ static r_status_t r_string_buffer_remove(r_state_t *rs, r_string_buffer_t *strin
         {
             string_buffer->buffer[i] = string_buffer->buffer[j];
         }
+
+        string_buffer->version = string_buffer->version + 1;
     }
 
     return status;
@@ -146,6 +149,7 @@ static r_status_t r_string_buffer_clear(r_state_t *rs, r_string_buffer_t *string
 {
     string_buffer->buffer[0] = '\0';
     string_buffer->length = 0;
+    string_buffer->version = string_buffer->version + 1;
 
     return R_SUCCESS;
 }
@@ -269,6 +273,7 @@ r_status_t r_string_buffer_init(r_state_t *rs, r_object_t *object)
     r_string_buffer_t *string_buffer = (r_string_buffer_t*)object;
 
     string_buffer->length = 0;
+    string_buffer->version = 0;
     string_buffer->allocated = R_STRING_BUFFER_DEFAULT_ALLOCATED;
     string_buffer->buffer = (char*)malloc(string_buffer->allocated * sizeof(char));
 
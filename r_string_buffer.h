@@ -34,6 +34,9 @@ typedef struct
     int             length;
     int             allocated;
     char            *buffer;
+
+    /* Incremented whenever the contents change (so that dependent data can be cached) */
+    unsigned int    version;
 } r_string_buffer_t;
 
 extern r_status_t r_string_buffer_setup(r_state_t *rs);
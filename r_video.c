@@ -21,6 +21,7 @@ THE SOFTWARE.
 */
 
 #include <math.h>
+#include <string.h>
 #include <SDL.h>
 #if (defined _MSC_VER)
 #include <windows.h>
@@ -45,6 +46,8 @@ THE SOFTWARE.
 #include "r_mesh.h"
 #include "r_collision_detector.h"
 #include "r_capture.h"
+#include "r_profiler.h"
+#include "r_video_offscreen.h"
 
 /* Height of the entire view (i.e. the max y coordinate is R_VIDEO_HEIGHT / 2 since the origin is in the center) */
 #define R_VIDEO_HEIGHT            (480.0)
@@ -70,40 +73,302 @@ typedef enum {
     R_VIDEO_PROPERTY_NONE           = 0x00000000
 } r_video_property_t;
 
+/* Scratch vertex buffer used for batched drawing (grown on demand and released in r_video_end) */
+typedef struct
+{
+    GLfloat u;
+    GLfloat v;
+    GLfloat red;
+    GLfloat green;
+    GLfloat blue;
+    GLfloat opacity;
+    GLfloat x;
+    GLfloat y;
+} r_video_vertex_t;
+
+static r_video_vertex_t *r_video_vertices = NULL;
+static unsigned int r_video_vertices_allocated = 0;
+
+/* Sprite batch (quads are accumulated in the scratch vertex buffer and grouped into runs that share a texture; runs
+ * are submitted in order, one draw call each) */
+#define R_VIDEO_BATCH_END                   0xffffffff
+#define R_VIDEO_BATCH_MAX_LOOKBACK          16
+#define R_VIDEO_BATCH_MAX_OVERLAP_TESTS     32
+
+typedef struct
+{
+    unsigned int    next;
+    GLfloat         x_min;
+    GLfloat         y_min;
+    GLfloat         x_max;
+    GLfloat         y_max;
+} r_video_batch_quad_t;
+
+typedef struct
+{
+    GLuint                  texture;
+    unsigned int            first_quad;
+    unsigned int            last_quad;
+    unsigned int            quad_count;
+    r_video_batch_quad_t    bounds;
+} r_video_batch_run_t;
+
+static r_video_batch_quad_t *r_video_batch_quads = NULL;
+static r_video_batch_run_t *r_video_batch_runs = NULL;
+static GLuint *r_video_batch_indices = NULL;
+static unsigned int r_video_batch_allocated = 0;
+static unsigned int r_video_batch_quad_count = 0;
+static unsigned int r_video_batch_run_count = 0;
+
+/* Fraction of the active layer's update step to interpolate entity transforms by (1 means no interpolation) */
+static r_real_t r_video_interpolation = 1;
+
+/* When pipelined, the last frame has been submitted but not yet displayed */
+static r_boolean_t r_video_swap_pending = R_FALSE;
+
+/* GL statistics for the frame being drawn and the last complete frame (state changes include blending, current color,
+ * client arrays, and matrix stack operations) */
+typedef struct
+{
+    unsigned int    draw_calls;
+    unsigned int    texture_binds;
+    unsigned int    state_changes;
+    unsigned int    vertices;
+} r_video_statistics_t;
+
+static r_video_statistics_t r_video_statistics_frame = { 0, 0, 0, 0 };
+static r_video_statistics_t r_video_statistics_last = { 0, 0, 0, 0 };
+
+/* Currently bound texture (only valid while drawing a frame, since textures are also bound when images are loaded) */
+static r_boolean_t r_video_bound_texture_valid = R_FALSE;
+static GLuint r_video_bound_texture = 0;
+
+/* Framebuffer objects (from GL_EXT_framebuffer_object, if supported) are used for rendering cached bitmaps */
+#ifndef GL_FRAMEBUFFER_EXT
+#define GL_FRAMEBUFFER_EXT              0x8D40
+#define GL_COLOR_ATTACHMENT0_EXT        0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE_EXT     0x8CD5
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE                0x812F
+#endif
+
+typedef void (APIENTRY *r_video_gl_gen_framebuffers_t)(GLsizei n, GLuint *framebuffers);
+typedef void (APIENTRY *r_video_gl_delete_framebuffers_t)(GLsizei n, const GLuint *framebuffers);
+typedef void (APIENTRY *r_video_gl_bind_framebuffer_t)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY *r_video_gl_framebuffer_texture_2d_t)(GLenum target, GLenum attachment, GLenum texture_target, GLuint texture, GLint level);
+typedef GLenum (APIENTRY *r_video_gl_check_framebuffer_status_t)(GLenum target);
+
+static r_video_gl_gen_framebuffers_t r_video_gl_gen_framebuffers = NULL;
+static r_video_gl_delete_framebuffers_t r_video_gl_delete_framebuffers = NULL;
+static r_video_gl_bind_framebuffer_t r_video_gl_bind_framebuffer = NULL;
+static r_video_gl_framebuffer_texture_2d_t r_video_gl_framebuffer_texture_2d = NULL;
+static r_video_gl_check_framebuffer_status_t r_video_gl_check_framebuffer_status = NULL;
+static r_boolean_t r_video_framebuffer_supported = R_FALSE;
+static GLuint r_video_framebuffer = 0;
+
+/* Without framebuffer objects, cached bitmaps are copied from the back buffer (which requires destination alpha) */
+static r_boolean_t r_video_back_buffer_alpha = R_FALSE;
+
+/* Separate alpha blending (OpenGL 1.4 or GL_EXT_blend_func_separate) is used to render cached bitmaps with premultiplied alpha */
+typedef void (APIENTRY *r_video_gl_blend_func_separate_t)(GLenum source_rgb, GLenum destination_rgb, GLenum source_alpha, GLenum destination_alpha);
+
+static r_video_gl_blend_func_separate_t r_video_gl_blend_func_separate = NULL;
+
+/* Cached entity bitmaps (each covers the entire view and is reused until the signature of its subtree changes) */
+typedef struct _r_video_bitmap_cache
+{
+    struct _r_video_bitmap_cache    *previous;
+    struct _r_video_bitmap_cache    *next;
+    r_boolean_t                     valid;
+    unsigned int                    signature;
+    GLuint                          texture;
+    unsigned int                    texture_width;
+    unsigned int                    texture_height;
+} r_video_bitmap_cache_t;
+
+static r_video_bitmap_cache_t *r_video_bitmap_caches = NULL;
+static r_boolean_t r_video_bitmap_cache_rendering = R_FALSE;
+static r_boolean_t r_video_bitmap_cache_redraw = R_FALSE;
+
 r_status_t r_glenum_to_status(GLenum gl)
 {
     return (gl == GL_NO_ERROR) ? R_SUCCESS : (R_F_BIT | R_FACILITY_VIDEO_GL | gl);
 }
 
+/* glGetError can synchronize with the driver, so while drawing it is only called after every operation in debug
+ * builds; otherwise errors are checked once at the end of each frame */
+R_INLINE r_status_t r_video_gl_check()
+{
+#ifdef R_DEBUG
+    return r_glenum_to_status(glGetError());
+#else
+    return R_SUCCESS;
+#endif
+}
+
+R_INLINE void r_video_gl_bind_texture(GLuint texture)
+{
+    /* Skip redundant binds */
+    if (!r_video_bound_texture_valid || r_video_bound_texture != texture)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        r_video_bound_texture = texture;
+        r_video_bound_texture_valid = R_TRUE;
+        ++r_video_statistics_frame.texture_binds;
+    }
+}
+
+R_INLINE void r_video_statistics_add_draw(unsigned int vertex_count)
+{
+    ++r_video_statistics_frame.draw_calls;
+    r_video_statistics_frame.vertices += vertex_count;
+}
+
+R_INLINE void r_video_statistics_add_state_changes(unsigned int count)
+{
+    r_video_statistics_frame.state_changes += count;
+}
+
+static void r_video_set_pixels_to_coordinates(r_state_t *rs)
+{
+    /* Set up pixel-to-coordinate transformation */
+    r_transform2d_init(&rs->pixels_to_coordinates);
+    r_transform2d_translate(&rs->pixels_to_coordinates, (r_real_t)(-rs->video_width) / 2, (r_real_t)(-rs->video_height) / 2);
+    r_transform2d_scale(&rs->pixels_to_coordinates, (r_real_t)(R_VIDEO_HEIGHT / rs->video_height), (r_real_t)(-R_VIDEO_HEIGHT / rs->video_height));
+}
+
+/* Displays the back buffer (offscreen rendering has no display, so drawing is just completed) */
+static void r_video_swap_buffers(r_state_t *rs)
+{
+    if (rs->video_offscreen)
+    {
+        glFinish();
+    }
+    else
+    {
+        SDL_GL_SwapBuffers();
+    }
+}
+
+static void *r_video_get_proc_address(r_state_t *rs, const char *name)
+{
+    return rs->video_offscreen ? r_video_offscreen_get_proc_address(name) : SDL_GL_GetProcAddress(name);
+}
+
+static void r_video_framebuffer_load(r_state_t *rs)
+{
+    const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+
+    r_video_framebuffer_supported = R_FALSE;
+
+    if (extensions != NULL && strstr(extensions, "GL_EXT_framebuffer_object") != NULL)
+    {
+        r_video_gl_gen_framebuffers = (r_video_gl_gen_framebuffers_t)r_video_get_proc_address(rs, "glGenFramebuffersEXT");
+        r_video_gl_delete_framebuffers = (r_video_gl_delete_framebuffers_t)r_video_get_proc_address(rs, "glDeleteFramebuffersEXT");
+        r_video_gl_bind_framebuffer = (r_video_gl_bind_framebuffer_t)r_video_get_proc_address(rs, "glBindFramebufferEXT");
+        r_video_gl_framebuffer_texture_2d = (r_video_gl_framebuffer_texture_2d_t)r_video_get_proc_address(rs, "glFramebufferTexture2DEXT");
+        r_video_gl_check_framebuffer_status = (r_video_gl_check_framebuffer_status_t)r_video_get_proc_address(rs, "glCheckFramebufferStatusEXT");
+
+        if (r_video_gl_gen_framebuffers != NULL
+            && r_video_gl_delete_framebuffers != NULL
+            && r_video_gl_bind_framebuffer != NULL
+            && r_video_gl_framebuffer_texture_2d != NULL
+            && r_video_gl_check_framebuffer_status != NULL)
+        {
+            r_video_framebuffer_supported = R_TRUE;
+        }
+    }
+}
+
 r_status_t r_video_set_mode(r_state_t *rs, unsigned int width, unsigned int height, r_boolean_t fullscreen)
 {
     r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
 
-    if (R_SUCCEEDED(status))
+    if (R_SUCCEEDED(status) && rs->headless && !rs->video_offscreen)
     {
-        status = (SDL_SetVideoMode((int)width, (int)height, 0, SDL_OPENGL | (fullscreen ? SDL_FULLSCREEN : 0)) != NULL) ? R_SUCCESS : R_FAILURE;
-
-        if (R_SUCCEEDED(status))
+        /* Headless; just record the mode. The video mode is never marked as set, so images are never loaded (or
+         * drawn) and the image and font caches hold placeholders. */
+        rs->video_width = width;
+        rs->video_height = height;
+        r_video_set_pixels_to_coordinates(rs);
+    }
+    else if (R_SUCCEEDED(status))
+    {
+        if (rs->video_offscreen)
         {
-            /* Grab input if using a fullscreen mode */
-            SDL_GrabMode grab_mode = fullscreen ? SDL_GRAB_ON : SDL_GRAB_OFF;
-            GLint max_texture_size = 512;
+            /* Render into an offscreen framebuffer (there is no window, so there is no input to grab or cursor to hide) */
+            status = r_video_offscreen_set_mode(rs, width, height);
+        }
+        else
+        {
+#if SDL_VERSION_ATLEAST(1, 2, 10)
+            /* Request synchronization to vertical refresh (this is a hint that the driver may ignore) */
+            SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, rs->video_vsync ? 1 : 0);
+#endif
+
+            /* Request destination alpha (so that cached bitmaps can be copied from the back buffer with transparency),
+             * but don't require it */
+            SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+
+            status = (SDL_SetVideoMode((int)width, (int)height, 0, SDL_OPENGL | (fullscreen ? SDL_FULLSCREEN : 0)) != NULL) ? R_SUCCESS : R_FAILURE;
 
-            if (grab_mode != SDL_WM_GrabInput(SDL_GRAB_QUERY))
+            if (R_FAILED(status))
             {
-                SDL_WM_GrabInput(grab_mode);
+                SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 0);
+
+                status = (SDL_SetVideoMode((int)width, (int)height, 0, SDL_OPENGL | (fullscreen ? SDL_FULLSCREEN : 0)) != NULL) ? R_SUCCESS : R_FAILURE;
             }
 
-            /* Don't show the cursor */
-            if (SDL_DISABLE != SDL_ShowCursor(SDL_QUERY))
+            if (R_SUCCEEDED(status))
+            {
+                /* Grab input if using a fullscreen mode */
+                SDL_GrabMode grab_mode = fullscreen ? SDL_GRAB_ON : SDL_GRAB_OFF;
+
+                if (grab_mode != SDL_WM_GrabInput(SDL_GRAB_QUERY))
+                {
+                    SDL_WM_GrabInput(grab_mode);
+                }
+
+                /* Don't show the cursor */
+                if (SDL_DISABLE != SDL_ShowCursor(SDL_QUERY))
+                {
+                    SDL_ShowCursor(SDL_DISABLE);
+                }
+            }
+            else
             {
-                SDL_ShowCursor(SDL_DISABLE);
+                r_log_error(rs, SDL_GetError());
             }
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            GLint max_texture_size = 512;
 
             rs->video_width = width;
             rs->video_height = height;
 
+            /* Check to see if buffer swaps will actually wait for vertical refresh */
+            rs->video_vsync_active = R_FALSE;
+
+#if SDL_VERSION_ATLEAST(1, 2, 10)
+            {
+                int swap_control = 0;
+
+                if (!rs->video_offscreen && rs->video_vsync && SDL_GL_GetAttribute(SDL_GL_SWAP_CONTROL, &swap_control) == 0 && swap_control > 0)
+                {
+                    rs->video_vsync_active = R_TRUE;
+                }
+            }
+#endif
+
             /* Get OpenGL implementation parameters */
             /* Check to see if OpenGL 1.2 is supported */
             {
@@ -121,6 +386,25 @@ r_status_t r_video_set_mode(r_state_t *rs, unsigned int width, unsigned int heig
                 {
                     rs->video_full_featured = R_TRUE;
                 }
+
+                /* Textures with dimensions that aren't powers of two are supported as of OpenGL 2.0 (or by extension) */
+                {
+                    const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+
+                    rs->video_npot_textures = (version >= 2.0 || (extensions != NULL && strstr(extensions, "GL_ARB_texture_non_power_of_two") != NULL)) ? R_TRUE : R_FALSE;
+
+                    /* Separate alpha blending is supported as of OpenGL 1.4 (or by extension) */
+                    r_video_gl_blend_func_separate = NULL;
+
+                    if (version >= 1.4)
+                    {
+                        r_video_gl_blend_func_separate = (r_video_gl_blend_func_separate_t)r_video_get_proc_address(rs, "glBlendFuncSeparate");
+                    }
+                    else if (extensions != NULL && strstr(extensions, "GL_EXT_blend_func_separate") != NULL)
+                    {
+                        r_video_gl_blend_func_separate = (r_video_gl_blend_func_separate_t)r_video_get_proc_address(rs, "glBlendFuncSeparateEXT");
+                    }
+                }
             }
 
             /* Query for maximum texture size */
@@ -130,10 +414,17 @@ r_status_t r_video_set_mode(r_state_t *rs, unsigned int width, unsigned int heig
             /* Assume minimum size is 8 since there isn't good documentation */
             rs->min_texture_size = 8;
 
-            /* Set up pixel-to-coordinate transformation */
-            r_transform2d_init(&rs->pixels_to_coordinates);
-            r_transform2d_translate(&rs->pixels_to_coordinates, (r_real_t)(-rs->video_width) / 2, (r_real_t)(-rs->video_height) / 2);
-            r_transform2d_scale(&rs->pixels_to_coordinates, (r_real_t)(R_VIDEO_HEIGHT / rs->video_height), (r_real_t)(-R_VIDEO_HEIGHT / rs->video_height));
+            /* Check for framebuffer object support (and destination alpha, for when framebuffer objects aren't available) */
+            r_video_framebuffer_load(rs);
+
+            {
+                GLint alpha_bits = 0;
+
+                glGetIntegerv(GL_ALPHA_BITS, &alpha_bits);
+                r_video_back_buffer_alpha = (alpha_bits > 0) ? R_TRUE : R_FALSE;
+            }
+
+            r_video_set_pixels_to_coordinates(rs);
 
             /* Initialize OpenGL */
             /* TODO: determine which OpenGL setup commands are actually needed */
@@ -153,20 +444,17 @@ r_status_t r_video_set_mode(r_state_t *rs, unsigned int width, unsigned int heig
             glEnable(GL_COLOR_MATERIAL);
 
             /* Clear the screen */
+            r_video_swap_pending = R_FALSE;
             glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
-            SDL_GL_SwapBuffers();
+            r_video_swap_buffers(rs);
             glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
-            SDL_GL_SwapBuffers();
+            r_video_swap_buffers(rs);
 
             status = r_glenum_to_status(glGetError());
         }
-        else
-        {
-            r_log_error(rs, SDL_GetError());
-        }
     }
 
-    if (R_SUCCEEDED(status))
+    if (R_SUCCEEDED(status) && (!rs->headless || rs->video_offscreen))
     {
         rs->video_mode_set = R_TRUE;
 
@@ -187,13 +475,27 @@ r_status_t r_video_start(r_state_t *rs, const char *application_name, const char
 
     if (R_SUCCEEDED(status))
     {
-        /* Initialize video subsystem */
-        status = (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_JOYSTICK) == 0) ? R_SUCCESS : R_FAILURE;
+        /* Initialize video subsystem (only the timer is needed when headless) */
+        status = (SDL_Init(rs->headless ? SDL_INIT_TIMER : (SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_JOYSTICK)) == 0) ? R_SUCCESS : R_FAILURE;
 
-        if (R_SUCCEEDED(status))
+        if (R_SUCCEEDED(status) && rs->headless)
         {
-            /* TODO: find a way in SDL to sync to vertical refresh rate */
-            /* Use double-buffering */
+            /* Set up image cache (images will not be loaded unless there is an offscreen video mode) */
+            status = (!rs->video_offscreen || r_video_offscreen_is_supported()) ? R_SUCCESS : R_F_NOT_IMPLEMENTED;
+
+            if (R_SUCCEEDED(status))
+            {
+                rs->default_font_path = default_font_path;
+                status = r_image_cache_start(rs);
+            }
+            else
+            {
+                r_log_error(rs, "Offscreen rendering is not supported (the engine must be built using \"--with-osmesa\")");
+            }
+        }
+        else if (R_SUCCEEDED(status))
+        {
+            /* Use double-buffering (synchronization to vertical refresh is requested when the mode is set) */
             SDL_WM_SetCaption(application_name, application_name);
             status = (SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1) == 0) ? R_SUCCESS : R_FAILURE;
 
@@ -225,6 +527,27 @@ void r_video_end(r_state_t *rs)
     if (R_SUCCEEDED(status))
     {
         r_image_cache_stop(rs);
+        r_video_bitmap_caches_release(rs);
+        r_video_offscreen_end(rs);
+
+        if (r_video_vertices != NULL)
+        {
+            free(r_video_vertices);
+            r_video_vertices = NULL;
+            r_video_vertices_allocated = 0;
+        }
+
+        if (r_video_batch_quads != NULL)
+        {
+            free(r_video_batch_quads);
+            free(r_video_batch_runs);
+            free(r_video_batch_indices);
+            r_video_batch_quads = NULL;
+            r_video_batch_runs = NULL;
+            r_video_batch_indices = NULL;
+            r_video_batch_allocated = 0;
+        }
+
         SDL_WM_GrabInput(SDL_GRAB_OFF);
         SDL_Quit();
     }
@@ -272,7 +595,8 @@ static int l_Video_getModes(lua_State *ls)
 
     if (R_SUCCEEDED(status))
     {
-        SDL_Rect **modes = SDL_ListModes(NULL, SDL_OPENGL | SDL_FULLSCREEN);
+        /* When headless, report any mode as available (so the default modes are listed) */
+        SDL_Rect **modes = rs->headless ? ((SDL_Rect**)(-1)) : SDL_ListModes(NULL, SDL_OPENGL | SDL_FULLSCREEN);
 
         status = (modes != 0) ? R_SUCCESS : R_FAILURE;
 
@@ -314,28 +638,29 @@ static int l_Video_getProperty(lua_State *ls, r_video_property_t properties)
 
     if (R_SUCCEEDED(status))
     {
+        /* There is no surface when headless, so report the recorded mode instead */
         SDL_Surface *surface = SDL_GetVideoSurface();
 
-        status = (surface != NULL) ? R_SUCCESS : R_VIDEO_FAILURE;
+        status = (surface != NULL || rs->headless) ? R_SUCCESS : R_VIDEO_FAILURE;
 
         if (R_SUCCEEDED(status))
         {
             /* Return the requested properties */
             if ((properties & R_VIDEO_PROPERTY_PIXEL_WIDTH) != 0)
             {
-                lua_pushnumber(ls, (lua_Number)surface->w);
+                lua_pushnumber(ls, (lua_Number)(rs->headless ? rs->video_width : surface->w));
                 ++result_count;
             }
 
             if ((properties & R_VIDEO_PROPERTY_PIXEL_HEIGHT) != 0)
             {
-                lua_pushnumber(ls, (lua_Number)surface->h);
+                lua_pushnumber(ls, (lua_Number)(rs->headless ? rs->video_height : surface->h));
                 ++result_count;
             }
 
             if ((properties & R_VIDEO_PROPERTY_FULLSCREEN) != 0)
             {
-                lua_pushboolean(ls, (surface->flags & SDL_FULLSCREEN) ? R_TRUE : R_FALSE);
+                lua_pushboolean(ls, (!rs->headless && (surface->flags & SDL_FULLSCREEN)) ? R_TRUE : R_FALSE);
                 ++result_count;
             }
         }
@@ -361,6 +686,142 @@ static int l_Video_getFullscreen(lua_State *ls)
     return l_Video_getProperty(ls, R_VIDEO_PROPERTY_FULLSCREEN);
 }
 
+static int l_Video_isHeadless(lua_State *ls)
+{
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushboolean(ls, rs->headless ? 1 : 0);
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Video_getVsync(lua_State *ls)
+{
+    /* Returns whether buffer swaps are synchronized to vertical refresh in the current mode */
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushboolean(ls, rs->video_vsync_active ? 1 : 0);
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Video_setVsync(lua_State *ls)
+{
+    /* Note: this takes effect when the video mode is next set */
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TBOOLEAN, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        rs->video_vsync = lua_toboolean(ls, 1) ? R_TRUE : R_FALSE;
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
+static int l_Video_getPipelined(lua_State *ls)
+{
+    /* Returns whether buffer swaps are deferred until the next frame is drawn */
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        lua_pushboolean(ls, rs->video_pipelined ? 1 : 0);
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Video_getStatistics(lua_State *ls)
+{
+    /* Returns GL call counts for the last frame that was drawn */
+    r_state_t *rs = r_script_get_r_state(ls);
+    int result_count = 0;
+    r_status_t status = r_script_verify_arguments(rs, 0, NULL);
+
+    if (R_SUCCEEDED(status))
+    {
+        int statistics_index = 0;
+
+        lua_newtable(ls);
+        statistics_index = lua_gettop(ls);
+
+        lua_pushliteral(ls, "drawCalls");
+        lua_pushnumber(ls, (lua_Number)r_video_statistics_last.draw_calls);
+        lua_rawset(ls, statistics_index);
+
+        lua_pushliteral(ls, "textureBinds");
+        lua_pushnumber(ls, (lua_Number)r_video_statistics_last.texture_binds);
+        lua_rawset(ls, statistics_index);
+
+        lua_pushliteral(ls, "stateChanges");
+        lua_pushnumber(ls, (lua_Number)r_video_statistics_last.state_changes);
+        lua_rawset(ls, statistics_index);
+
+        lua_pushliteral(ls, "vertices");
+        lua_pushnumber(ls, (lua_Number)r_video_statistics_last.vertices);
+        lua_rawset(ls, statistics_index);
+
+        lua_insert(ls, 1);
+        result_count = 1;
+    }
+
+    lua_pop(ls, lua_gettop(ls) - result_count);
+
+    return result_count;
+}
+
+static int l_Video_setPipelined(lua_State *ls)
+{
+    /* Note: pipelining lets the next update run while the GPU renders the last frame, but it can add up to a frame of
+     * display latency */
+    r_state_t *rs = r_script_get_r_state(ls);
+    const r_script_argument_t expected_arguments[] = {
+        { LUA_TBOOLEAN, 0 }
+    };
+
+    r_status_t status = r_script_verify_arguments(rs, R_ARRAY_SIZE(expected_arguments), expected_arguments);
+
+    if (R_SUCCEEDED(status))
+    {
+        rs->video_pipelined = lua_toboolean(ls, 1) ? R_TRUE : R_FALSE;
+    }
+
+    lua_pop(ls, lua_gettop(ls));
+
+    return 0;
+}
+
 static int l_Video_setMode(lua_State *ls)
 {
     r_state_t *rs = r_script_get_r_state(ls);
@@ -440,8 +901,14 @@ r_status_t r_video_setup(r_state_t *rs)
             { "getPixelHeight", R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_getPixelHeight },
             { "getFullscreen",  R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_getFullscreen },
             { "getModes",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_getModes },
+            { "getPipelined",   R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_getPipelined },
+            { "getStatistics",  R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_getStatistics },
+            { "getVsync",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_getVsync },
+            { "isHeadless",     R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_isHeadless },
             { "setMode",        R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_setMode },
+            { "setPipelined",   R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_setPipelined },
             { "setTitle",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_setTitle },
+            { "setVsync",       R_SCRIPT_NODE_TYPE_FUNCTION, NULL, l_Video_setVsync },
             { NULL }
         };
 
@@ -456,58 +923,384 @@ r_status_t r_video_setup(r_state_t *rs)
     return status;
 }
 
-R_INLINE void r_video_color_get_current_color(r_color_t *color_base)
+/* Modulates the inherited color by an (optional) color; the result is only ever emitted as vertex colors, so the GL color is never queried */
+R_INLINE void r_video_color_blend(GLfloat *result, const GLfloat *color_base, const r_color_t *color)
 {
-    GLfloat values[4];
-
-    glGetFloatv(GL_CURRENT_COLOR, values);
+    result[0] = color_base[0];
+    result[1] = color_base[1];
+    result[2] = color_base[2];
+    result[3] = color_base[3];
 
-    color_base->red      = values[0];
-    color_base->green    = values[1];
-    color_base->blue     = values[2];
-    color_base->opacity  = values[3];
+    if (color != NULL)
+    {
+        result[0] *= color->red;
+        result[1] *= color->green;
+        result[2] *= color->blue;
+        result[3] *= color->opacity;
+    }
 }
 
-R_INLINE void r_video_color_blend(const r_color_t *color_base, const r_color_t *color)
+static r_status_t r_video_vertices_reserve(r_state_t *rs, unsigned int count)
 {
-    glColor4f(color_base->red * color->red, color_base->green * color->green, color_base->blue * color->blue, color_base->opacity * color->opacity);
+    r_status_t status = R_SUCCESS;
+
+    if (count > r_video_vertices_allocated)
+    {
+        unsigned int new_allocated = R_MAX(count, r_video_vertices_allocated * 2);
+        r_video_vertex_t *new_vertices = (r_video_vertex_t*)realloc(r_video_vertices, new_allocated * sizeof(r_video_vertex_t));
+
+        status = (new_vertices != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_video_vertices = new_vertices;
+            r_video_vertices_allocated = new_allocated;
+        }
+    }
+
+    return status;
 }
 
-static void r_video_color_unblend(r_color_t *color_base)
+R_INLINE void r_video_vertex_set(r_video_vertex_t *vertex, GLfloat u, GLfloat v, const GLfloat *color, GLfloat x, GLfloat y)
 {
-    glColor4f(color_base->red, color_base->green, color_base->blue, color_base->opacity);
+    vertex->u       = u;
+    vertex->v       = v;
+    vertex->red     = color[0];
+    vertex->green   = color[1];
+    vertex->blue    = color[2];
+    vertex->opacity = color[3];
+    vertex->x       = x;
+    vertex->y       = y;
 }
 
-static r_status_t r_video_draw_image_internal(r_state_t *rs, r_image_t *image, r_boolean_t region, r_real_t u1, r_real_t v1, r_real_t u2, r_real_t v2)
+/* Computes parent * translate(x, y) * rotate(angle) * scale(width, height) (i.e. the same order as the OpenGL calls) */
+static void r_video_transform_compose(r_transform2d_t *result, r_transform2d_t *parent, r_real_t x, r_real_t y, r_real_t angle, r_real_t width, r_real_t height)
 {
-    /* TODO: Cache the results of these calculations somewhere */
-    switch (image->storage_type)
+    const r_real_t theta = (r_real_t)(angle * R_PI_OVER_180);
+    const r_real_t cosine_theta = (angle != 0) ? (r_real_t)cos(theta) : 1;
+    const r_real_t sine_theta = (angle != 0) ? (r_real_t)sin(theta) : 0;
+    const r_real_t m00 = cosine_theta * width;
+    const r_real_t m01 = -sine_theta * height;
+    const r_real_t m10 = sine_theta * width;
+    const r_real_t m11 = cosine_theta * height;
+    int i;
+
+    for (i = 0; i < 2; ++i)
     {
-    case R_IMAGE_STORAGE_NATIVE:
-        /* Draw a single rectangle using the (single) texture */
-        glBindTexture(GL_TEXTURE_2D, (GLuint)(image->storage.native.id));
+        const r_real_t p0 = (*parent)[i][0];
+        const r_real_t p1 = (*parent)[i][1];
 
-        glBegin(GL_POLYGON);
-        glTexCoord2f(u1, v1);
-        glVertex3f(-0.5f, 0.5f, 0.0f);
+        (*result)[i][2] = p0 * x + p1 * y + (*parent)[i][2];
+        (*result)[i][0] = p0 * m00 + p1 * m10;
+        (*result)[i][1] = p0 * m01 + p1 * m11;
+    }
 
-        glTexCoord2f(u1, v2);
-        glVertex3f(-0.5f, -0.5f, 0.0f);
+    (*result)[2][0] = 0;
+    (*result)[2][1] = 0;
+    (*result)[2][2] = 1;
+}
 
-        glTexCoord2f(u2, v2);
-        glVertex3f(0.5f, -0.5f, 0.0f);
+R_INLINE void r_video_transform_translate(r_transform2d_t *transform, r_real_t x, r_real_t y)
+{
+    (*transform)[0][2] += (*transform)[0][0] * x + (*transform)[0][1] * y;
+    (*transform)[1][2] += (*transform)[1][0] * x + (*transform)[1][1] * y;
+}
 
-        glTexCoord2f(u2, v1);
-        glVertex3f(0.5f, 0.5f, 0.0f);
-        glEnd();
-        break;
+/* Multiplies the current OpenGL matrix by a transformation (for drawing that does not go through the sprite batch) */
+static void r_video_multiply_matrix(r_transform2d_t *transform)
+{
+    GLfloat m[16];
 
-    case R_IMAGE_STORAGE_COMPOSITE:
-        {
-            /* Draw using one rectangle per element */
-            const unsigned int columns = image->storage.composite.columns;
-            const unsigned int rows = image->storage.composite.rows;
-            unsigned int i, j;
+    m[0]  = (*transform)[0][0];
+    m[1]  = (*transform)[1][0];
+    m[2]  = 0;
+    m[3]  = 0;
+
+    m[4]  = (*transform)[0][1];
+    m[5]  = (*transform)[1][1];
+    m[6]  = 0;
+    m[7]  = 0;
+
+    m[8]  = 0;
+    m[9]  = 0;
+    m[10] = 1;
+    m[11] = 0;
+
+    m[12] = (*transform)[0][2];
+    m[13] = (*transform)[1][2];
+    m[14] = 0;
+    m[15] = 1;
+
+    glMultMatrixf(m);
+}
+
+static r_status_t r_video_batch_reserve(r_state_t *rs, unsigned int quad_count)
+{
+    /* Quads, runs, and indices are all bounded by the number of quads */
+    r_status_t status = r_video_vertices_reserve(rs, quad_count * 4);
+
+    if (R_SUCCEEDED(status) && quad_count > r_video_batch_allocated)
+    {
+        unsigned int new_allocated = R_MAX(quad_count, r_video_batch_allocated * 2);
+        r_video_batch_quad_t *new_quads = (r_video_batch_quad_t*)realloc(r_video_batch_quads, new_allocated * sizeof(r_video_batch_quad_t));
+
+        status = (new_quads != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            r_video_batch_run_t *new_runs = NULL;
+
+            r_video_batch_quads = new_quads;
+            new_runs = (r_video_batch_run_t*)realloc(r_video_batch_runs, new_allocated * sizeof(r_video_batch_run_t));
+            status = (new_runs != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+            if (R_SUCCEEDED(status))
+            {
+                GLuint *new_indices = NULL;
+
+                r_video_batch_runs = new_runs;
+                new_indices = (GLuint*)realloc(r_video_batch_indices, new_allocated * 4 * sizeof(GLuint));
+                status = (new_indices != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+                if (R_SUCCEEDED(status))
+                {
+                    r_video_batch_indices = new_indices;
+                    r_video_batch_allocated = new_allocated;
+                }
+            }
+        }
+    }
+
+    return status;
+}
+
+/* Submits all batched quads, one draw call per run (this must be done before anything is drawn outside of the batch) */
+static r_status_t r_video_batch_flush(r_state_t *rs)
+{
+    r_status_t status = R_SUCCESS;
+
+    if (r_video_batch_quad_count > 0)
+    {
+        unsigned int index_count = 0;
+        unsigned int i;
+
+        /* Gather each run's vertex indices */
+        for (i = 0; i < r_video_batch_run_count; ++i)
+        {
+            unsigned int quad;
+
+            for (quad = r_video_batch_runs[i].first_quad; quad != R_VIDEO_BATCH_END; quad = r_video_batch_quads[quad].next)
+            {
+                r_video_batch_indices[index_count++] = quad * 4;
+                r_video_batch_indices[index_count++] = quad * 4 + 1;
+                r_video_batch_indices[index_count++] = quad * 4 + 2;
+                r_video_batch_indices[index_count++] = quad * 4 + 3;
+            }
+        }
+
+        /* Note: the color array leaves the current color undefined, so anything drawn outside of the batch sets its own color */
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+
+        glTexCoordPointer(2, GL_FLOAT, sizeof(r_video_vertex_t), &r_video_vertices[0].u);
+        glColorPointer(4, GL_FLOAT, sizeof(r_video_vertex_t), &r_video_vertices[0].red);
+        glVertexPointer(2, GL_FLOAT, sizeof(r_video_vertex_t), &r_video_vertices[0].x);
+
+        for (i = 0, index_count = 0; i < r_video_batch_run_count; ++i)
+        {
+            const r_video_batch_run_t *run = &r_video_batch_runs[i];
+
+            r_video_gl_bind_texture(run->texture);
+            glDrawElements(GL_QUADS, (GLsizei)(run->quad_count * 4), GL_UNSIGNED_INT, &r_video_batch_indices[index_count]);
+            r_video_statistics_add_draw(run->quad_count * 4);
+            index_count += run->quad_count * 4;
+        }
+
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+
+        /* Enabling, pointing to, and disabling three client arrays */
+        r_video_statistics_add_state_changes(9);
+        r_video_batch_quad_count = 0;
+        r_video_batch_run_count = 0;
+
+        status = r_video_gl_check();
+    }
+
+    return status;
+}
+
+R_INLINE r_boolean_t r_video_batch_quad_overlaps(const r_video_batch_quad_t *a, const r_video_batch_quad_t *b)
+{
+    return (a->x_min < b->x_max && b->x_min < a->x_max && a->y_min < b->y_max && b->y_min < a->y_max) ? R_TRUE : R_FALSE;
+}
+
+static r_boolean_t r_video_batch_run_overlaps(const r_video_batch_run_t *run, const r_video_batch_quad_t *quad)
+{
+    /* Check the run's bounds first, then its quads (large runs just use their bounds) */
+    r_boolean_t overlaps = r_video_batch_quad_overlaps(&run->bounds, quad);
+
+    if (overlaps && run->quad_count <= R_VIDEO_BATCH_MAX_OVERLAP_TESTS)
+    {
+        unsigned int i;
+
+        overlaps = R_FALSE;
+
+        for (i = run->first_quad; i != R_VIDEO_BATCH_END && !overlaps; i = r_video_batch_quads[i].next)
+        {
+            overlaps = r_video_batch_quad_overlaps(&r_video_batch_quads[i], quad);
+        }
+    }
+
+    return overlaps;
+}
+
+/* Adds a quad with corners (x1, y1) (top-left) and (x2, y2) (bottom-right) to the sprite batch */
+static r_status_t r_video_batch_add_quad(r_state_t *rs, GLuint texture, r_transform2d_t *transform, const GLfloat *color, r_real_t x1, r_real_t y1, r_real_t x2, r_real_t y2, r_real_t u1, r_real_t v1, r_real_t u2, r_real_t v2)
+{
+    r_status_t status = r_video_batch_reserve(rs, r_video_batch_quad_count + 1);
+
+    if (R_SUCCEEDED(status))
+    {
+        /* Transform the corners on the CPU (vertices are in the untransformed view coordinates) */
+        const unsigned int quad_index = r_video_batch_quad_count;
+        r_video_batch_quad_t *quad = &r_video_batch_quads[quad_index];
+        r_video_vertex_t *vertices = &r_video_vertices[quad_index * 4];
+        const GLfloat x1x = (GLfloat)((*transform)[0][0] * x1);
+        const GLfloat x1y = (GLfloat)((*transform)[1][0] * x1);
+        const GLfloat x2x = (GLfloat)((*transform)[0][0] * x2);
+        const GLfloat x2y = (GLfloat)((*transform)[1][0] * x2);
+        const GLfloat y1x = (GLfloat)((*transform)[0][1] * y1 + (*transform)[0][2]);
+        const GLfloat y1y = (GLfloat)((*transform)[1][1] * y1 + (*transform)[1][2]);
+        const GLfloat y2x = (GLfloat)((*transform)[0][1] * y2 + (*transform)[0][2]);
+        const GLfloat y2y = (GLfloat)((*transform)[1][1] * y2 + (*transform)[1][2]);
+        unsigned int run_index = r_video_batch_run_count;
+        unsigned int i;
+        int j;
+
+        r_video_vertex_set(&vertices[0], u1, v1, color, x1x + y1x, x1y + y1y);
+        r_video_vertex_set(&vertices[1], u1, v2, color, x1x + y2x, x1y + y2y);
+        r_video_vertex_set(&vertices[2], u2, v2, color, x2x + y2x, x2y + y2y);
+        r_video_vertex_set(&vertices[3], u2, v1, color, x2x + y1x, x2y + y1y);
+
+        quad->next = R_VIDEO_BATCH_END;
+        quad->x_min = quad->x_max = vertices[0].x;
+        quad->y_min = quad->y_max = vertices[0].y;
+
+        for (j = 1; j < 4; ++j)
+        {
+            quad->x_min = (R_MIN(quad->x_min, vertices[j].x));
+            quad->x_max = (R_MAX(quad->x_max, vertices[j].x));
+            quad->y_min = (R_MIN(quad->y_min, vertices[j].y));
+            quad->y_max = (R_MAX(quad->y_max, vertices[j].y));
+        }
+
+        /* Painter's order only matters where quads overlap, so the quad can join the most recent run with the same
+         * texture as long as it doesn't overlap anything in the runs after it */
+        for (i = r_video_batch_run_count; i > 0 && r_video_batch_run_count - i < R_VIDEO_BATCH_MAX_LOOKBACK; --i)
+        {
+            const r_video_batch_run_t *run = &r_video_batch_runs[i - 1];
+
+            if (run->texture == texture)
+            {
+                run_index = i - 1;
+                break;
+            }
+            else if (r_video_batch_run_overlaps(run, quad))
+            {
+                break;
+            }
+        }
+
+        if (run_index < r_video_batch_run_count)
+        {
+            /* Append to the existing run */
+            r_video_batch_run_t *run = &r_video_batch_runs[run_index];
+
+            r_video_batch_quads[run->last_quad].next = quad_index;
+            run->last_quad = quad_index;
+            ++run->quad_count;
+
+            run->bounds.x_min = (R_MIN(run->bounds.x_min, quad->x_min));
+            run->bounds.x_max = (R_MAX(run->bounds.x_max, quad->x_max));
+            run->bounds.y_min = (R_MIN(run->bounds.y_min, quad->y_min));
+            run->bounds.y_max = (R_MAX(run->bounds.y_max, quad->y_max));
+        }
+        else
+        {
+            /* Start a new run */
+            r_video_batch_run_t *run = &r_video_batch_runs[r_video_batch_run_count++];
+
+            run->texture = texture;
+            run->first_quad = quad_index;
+            run->last_quad = quad_index;
+            run->quad_count = 1;
+            run->bounds = *quad;
+        }
+
+        ++r_video_batch_quad_count;
+    }
+
+    return status;
+}
+
+/* Adds a quad for an image that uses a single texture (either its own or an atlas page) to the sprite batch */
+static r_status_t r_video_batch_add_image_quad(r_state_t *rs, r_image_t *image, r_transform2d_t *transform, const GLfloat *color, r_real_t x1, r_real_t y1, r_real_t x2, r_real_t y2, r_real_t u1, r_real_t v1, r_real_t u2, r_real_t v2)
+{
+    r_status_t status = R_SUCCESS;
+
+    switch (image->storage_type)
+    {
+    case R_IMAGE_STORAGE_NATIVE:
+        status = r_video_batch_add_quad(rs, (GLuint)(image->storage.native.id), transform, color, x1, y1, x2, y2, u1, v1, u2, v2);
+        break;
+
+    case R_IMAGE_STORAGE_ATLAS:
+        {
+            /* Map the texture coordinates into the image's area of the atlas page */
+            const r_real_t atlas_width = image->storage.atlas.u2 - image->storage.atlas.u1;
+            const r_real_t atlas_height = image->storage.atlas.v2 - image->storage.atlas.v1;
+
+            status = r_video_batch_add_quad(rs, (GLuint)(image->storage.atlas.id), transform, color, x1, y1, x2, y2,
+                                            image->storage.atlas.u1 + u1 * atlas_width,
+                                            image->storage.atlas.v1 + v1 * atlas_height,
+                                            image->storage.atlas.u1 + u2 * atlas_width,
+                                            image->storage.atlas.v1 + v2 * atlas_height);
+        }
+        break;
+
+    default:
+        R_ASSERT(0); /* Unsupported storage type */
+        break;
+    }
+
+    return status;
+}
+
+static r_status_t r_video_draw_image_internal(r_state_t *rs, r_image_t *image, r_transform2d_t *transform, const GLfloat *color, r_boolean_t region, r_real_t u1, r_real_t v1, r_real_t u2, r_real_t v2)
+{
+    r_status_t status = R_SUCCESS;
+
+    /* TODO: Cache the results of these calculations somewhere */
+    switch (image->storage_type)
+    {
+    case R_IMAGE_STORAGE_NATIVE:
+    case R_IMAGE_STORAGE_ATLAS:
+        /* Add a single rectangle using the (single) texture to the batch */
+        status = r_video_batch_add_image_quad(rs, image, transform, color, -0.5f, 0.5f, 0.5f, -0.5f, u1, v1, u2, v2);
+        break;
+
+    case R_IMAGE_STORAGE_COMPOSITE:
+        status = r_video_batch_flush(rs);
+
+        if (R_SUCCEEDED(status))
+        {
+            /* Draw using one rectangle per element */
+            const unsigned int columns = image->storage.composite.columns;
+            const unsigned int rows = image->storage.composite.rows;
+            unsigned int i, j;
 
             /* Position of the current element */
             r_real_t x1, y1;
@@ -534,8 +1327,10 @@ static r_status_t r_video_draw_image_internal(r_state_t *rs, r_image_t *image, r
                 j2 = R_MIN(j2, (unsigned int)ceil(v2 * total_height / element_height));
             }
 
-            /* TODO: Maybe don't push a new matrix just for this... */
+            glColor4fv(color);
+
             glPushMatrix();
+            r_video_multiply_matrix(transform);
             glTranslatef(-0.5f, 0.5f, 0);
 
             for (j = j1, y1 = 0.0f; j < j2; ++j)
@@ -625,220 +1420,842 @@ static r_status_t r_video_draw_image_internal(r_state_t *rs, r_image_t *image, r
                                 }
                             }
 
-                            /* Weight the size according to the amount of the image shown */
-                            x2 = x2 * (element_u2 - element_u1);
-                        }
-                    }
+                            /* Weight the size according to the amount of the image shown */
+                            x2 = x2 * (element_u2 - element_u1);
+                        }
+                    }
+
+                    /* Use the given texture */
+                    r_video_gl_bind_texture((GLuint)(element->id));
+
+                    /* Draw the rectangle */
+                    glBegin(GL_POLYGON);
+                    glTexCoord2f(element_u1 * element_x2, element_v1 * element_y2);
+                    glVertex3f(x1, y1, 0.0f);
+
+                    glTexCoord2f(element_u1 * element_x2, element_v2 * element_y2);
+                    glVertex3f(x1, y2, 0.0f);
+
+                    glTexCoord2f(element_u2 * element_x2, element_v2 * element_y2);
+                    glVertex3f(x2, y2, 0.0f);
+
+                    glTexCoord2f(element_u2 * element_x2, element_v1 * element_y2);
+                    glVertex3f(x2, y1, 0.0f);
+                    glEnd();
+                    r_video_statistics_add_draw(4);
+
+                    /* Move to the next element's area */
+                    x1 = x2;
+                }
+
+                /* Move to the next element's area */
+                y1 = y2;
+            }
+
+            glPopMatrix();
+
+            /* Color, push, multiply, translate, and pop */
+            r_video_statistics_add_state_changes(5);
+            status = r_video_gl_check();
+        }
+        break;
+
+    default:
+        R_ASSERT(0); /* Unsupported storage type */
+        break;
+    }
+
+    return status;
+}
+
+static r_status_t r_video_draw_particle_emitter(r_state_t *rs, r_element_particle_emitter_t *element_particle_emitter, r_transform2d_t *entity_transform, const GLfloat *color_base)
+{
+    /* Particles are in the layer's coordinate space (layers are drawn using the identity transformation), but their size
+     * follows the entity's scale; particle colors are modulated by the element's (inherited) color */
+    r_status_t status = R_SUCCESS;
+    r_image_t *image = (r_image_t*)element_particle_emitter->element.image.value.object;
+    const unsigned int count = element_particle_emitter->count;
+    const r_real_t width = element_particle_emitter->element.width * (r_real_t)sqrt((*entity_transform)[0][0] * (*entity_transform)[0][0] + (*entity_transform)[1][0] * (*entity_transform)[1][0]);
+    const r_real_t height = element_particle_emitter->element.height * (r_real_t)sqrt((*entity_transform)[0][1] * (*entity_transform)[0][1] + (*entity_transform)[1][1] * (*entity_transform)[1][1]);
+    const r_real_t half_width = width / 2;
+    const r_real_t half_height = height / 2;
+    const r_real_t frame_width = ((r_real_t)1) / (R_MAX(element_particle_emitter->frames, 1));
+    r_transform2d_t transform;
+    unsigned int i;
+
+    r_transform2d_init(&transform);
+
+    for (i = 0; i < count && R_SUCCEEDED(status); ++i)
+    {
+        const r_particle_t *particle = &element_particle_emitter->particles[i];
+        const r_real_t u1 = particle->frame * frame_width;
+        GLfloat color[4];
+
+        color[0] = color_base[0] * particle->color[0];
+        color[1] = color_base[1] * particle->color[1];
+        color[2] = color_base[2] * particle->color[2];
+        color[3] = color_base[3] * particle->color[3];
+
+        if (image->storage_type != R_IMAGE_STORAGE_COMPOSITE)
+        {
+            status = r_video_batch_add_image_quad(rs, image, &transform, color,
+                                                  particle->x - half_width, particle->y + half_height,
+                                                  particle->x + half_width, particle->y - half_height,
+                                                  u1, 0, u1 + frame_width, 1);
+        }
+        else
+        {
+            /* Composite images span multiple textures, so draw each particle separately */
+            r_transform2d_t particle_transform;
+
+            r_video_transform_compose(&particle_transform, &transform, particle->x, particle->y, 0, width, height);
+            status = r_video_draw_image_internal(rs, image, &particle_transform, color, R_TRUE, u1, 0, u1 + frame_width, 1);
+        }
+    }
+
+    return status;
+}
+
+static r_status_t r_video_draw_tilemap(r_state_t *rs, r_element_tilemap_t *element_tilemap, r_transform2d_t *transform, const GLfloat *color)
+{
+    r_status_t status = r_element_tilemap_reserve(rs, element_tilemap);
+
+    if (R_SUCCEEDED(status) && element_tilemap->chunks != NULL)
+    {
+        r_image_t *image = (r_image_t*)element_tilemap->element.image.value.object;
+
+        /* Visible range of tiles (exclusive upper bound) */
+        unsigned int i1 = 0;
+        unsigned int j1 = 0;
+        unsigned int i2 = element_tilemap->columns;
+        unsigned int j2 = element_tilemap->rows;
+
+        /* Find the view rectangle in tile coordinates by inverting the transformation */
+        {
+            const r_real_t determinant = (*transform)[0][0] * (*transform)[1][1] - (*transform)[0][1] * (*transform)[1][0];
+
+            if (determinant != 0)
+            {
+                const r_real_t view_half_height = (r_real_t)(R_VIDEO_HEIGHT / 2);
+                const r_real_t view_half_width = view_half_height * rs->video_width / rs->video_height;
+                r_real_t x_min = 0;
+                r_real_t x_max = 0;
+                r_real_t y_min = 0;
+                r_real_t y_max = 0;
+                int corner;
+
+                for (corner = 0; corner < 4; ++corner)
+                {
+                    const r_real_t ex = ((corner & 1) ? view_half_width : -view_half_width) - (*transform)[0][2];
+                    const r_real_t ey = ((corner & 2) ? view_half_height : -view_half_height) - (*transform)[1][2];
+                    const r_real_t x = ((*transform)[1][1] * ex - (*transform)[0][1] * ey) / determinant;
+                    const r_real_t y = ((*transform)[0][0] * ey - (*transform)[1][0] * ex) / determinant;
+
+                    x_min = (corner == 0) ? x : (R_MIN(x_min, x));
+                    x_max = (corner == 0) ? x : (R_MAX(x_max, x));
+                    y_min = (corner == 0) ? y : (R_MIN(y_min, y));
+                    y_max = (corner == 0) ? y : (R_MAX(y_max, y));
+                }
+
+                /* Row j covers [-j - 1, -j] */
+                i1 = (x_min > 0) ? (R_MIN((unsigned int)x_min, i2)) : 0;
+                i2 = (x_max > 0) ? (R_MIN((unsigned int)ceil(x_max), i2)) : 0;
+                j1 = (y_max < 0) ? (R_MIN((unsigned int)(-y_max), j2)) : 0;
+                j2 = (y_min < 0) ? (R_MIN((unsigned int)ceil(-y_min), j2)) : 0;
+            }
+        }
+
+        if (image->storage_type == R_IMAGE_STORAGE_NATIVE)
+        {
+            /* Draw each visible chunk's cached geometry (outside of the batch, since it is already in vertex arrays) */
+            unsigned int chunk_column, chunk_row;
+
+            status = r_video_batch_flush(rs);
+
+            if (R_SUCCEEDED(status))
+            {
+                glColor4fv(color);
+                glPushMatrix();
+                r_video_multiply_matrix(transform);
+
+                r_video_gl_bind_texture((GLuint)(image->storage.native.id));
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+                for (chunk_row = j1 / R_TILEMAP_CHUNK_SIZE; chunk_row * R_TILEMAP_CHUNK_SIZE < j2 && R_SUCCEEDED(status); ++chunk_row)
+                {
+                    for (chunk_column = i1 / R_TILEMAP_CHUNK_SIZE; chunk_column * R_TILEMAP_CHUNK_SIZE < i2 && R_SUCCEEDED(status); ++chunk_column)
+                    {
+                        r_tilemap_chunk_t *chunk = &element_tilemap->chunks[chunk_row * element_tilemap->chunk_columns + chunk_column];
+
+                        status = r_element_tilemap_chunk_build(rs, element_tilemap, chunk_column, chunk_row);
+
+                        if (R_SUCCEEDED(status) && chunk->vertex_count > 0)
+                        {
+                            glVertexPointer(2, GL_FLOAT, 4 * sizeof(r_real_t), &chunk->vertices[0]);
+                            glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(r_real_t), &chunk->vertices[2]);
+                            glDrawArrays(GL_QUADS, 0, (GLsizei)chunk->vertex_count);
+                            r_video_statistics_add_state_changes(2);
+                            r_video_statistics_add_draw(chunk->vertex_count);
+                        }
+                    }
+                }
+
+                glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+                glDisableClientState(GL_VERTEX_ARRAY);
+                glPopMatrix();
+
+                /* Color, push, multiply, enabling and disabling two client arrays, and pop */
+                r_video_statistics_add_state_changes(8);
+            }
+        }
+        else
+        {
+            /* Composite (and atlas) images can't use the chunk geometry, so draw each visible tile separately */
+            const unsigned int atlas_columns = R_MAX(element_tilemap->atlas_columns, 1);
+            const unsigned int atlas_rows = R_MAX(element_tilemap->atlas_rows, 1);
+            const r_real_t atlas_u = ((r_real_t)1) / atlas_columns;
+            const r_real_t atlas_v = ((r_real_t)1) / atlas_rows;
+            unsigned int i, j;
+
+            for (j = j1; j < j2 && R_SUCCEEDED(status); ++j)
+            {
+                for (i = i1; i < i2 && R_SUCCEEDED(status); ++i)
+                {
+                    const unsigned int tile = element_tilemap->tiles[j * element_tilemap->columns + i];
+
+                    if (tile > 0 && tile <= atlas_columns * atlas_rows)
+                    {
+                        const r_real_t u1 = ((tile - 1) % atlas_columns) * atlas_u;
+                        const r_real_t v1 = ((tile - 1) / atlas_columns) * atlas_v;
+                        r_transform2d_t tile_transform;
+
+                        r_transform2d_copy(&tile_transform, transform);
+                        r_video_transform_translate(&tile_transform, i + 0.5f, -(r_real_t)j - 0.5f);
+                        status = r_video_draw_image_internal(rs, image, &tile_transform, color, R_TRUE, u1, v1, u1 + atlas_u, v1 + atlas_v);
+                    }
+                }
+            }
+        }
+    }
+
+    return status;
+}
+
+static r_status_t r_video_draw_element(r_state_t *rs, r_element_t *element, r_transform2d_t *entity_transform, const GLfloat *entity_color)
+{
+    r_status_t status = (element != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+    if (R_SUCCEEDED(status))
+    {
+        /* Common element setup */
+        GLfloat element_color[4];
+
+        r_video_color_blend(element_color, entity_color, (r_color_t*)element->color.value.object);
+
+        if (element->image.value.object != NULL && element_color[3] > 0)
+        {
+            r_transform2d_t transform;
+
+            /* Particles are already in the layer's coordinate space */
+            if (element->element_type != R_ELEMENT_TYPE_PARTICLE_EMITTER)
+            {
+                r_video_transform_compose(&transform, entity_transform, element->x, element->y, element->angle, element->width, element->height);
+            }
+
+            switch (element->element_type)
+            {
+            case R_ELEMENT_TYPE_IMAGE:
+                status = r_video_draw_image_internal(rs, (r_image_t*)element->image.value.object, &transform, element_color, R_FALSE, 0, 0, 1, 1);
+                break;
+
+            case R_ELEMENT_TYPE_IMAGE_REGION:
+                {
+                    /* TODO: Coordinate checks could go in the "set" functions */
+                    const r_element_image_region_t *element_image_region = (r_element_image_region_t*)element;
+                    r_image_t *image = (r_image_t*)element->image.value.object;
+                    r_real_t u1 = R_MAX(0, element_image_region->u1);
+                    r_real_t v1 = R_MAX(0, element_image_region->v1);
+                    r_real_t u2 = R_MIN(1, element_image_region->u2);
+                    r_real_t v2 = R_MIN(1, element_image_region->v2);
+
+                    /* Sanity-check the texture coordinates */
+                    if (u1 < 0 || v1 < 0 || u2 > 1 || v2 > 1 || u1 >= u2 || v1 >= v2)
+                    {
+                        status = RV_F_BAD_COORDINATES;
+                    }
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        status = r_video_draw_image_internal(rs, image, &transform, element_color, R_TRUE, u1, v1, u2, v2);
+                    }
+                }
+                break;
+
+            case R_ELEMENT_TYPE_ANIMATION:
+                {
+                    /* Draw the current frame */
+                    const r_element_animation_t *element_animation = (r_element_animation_t*)element;
+                    const r_animation_t *animation = (r_animation_t*)element->image.value.object;
+
+                    if (animation->frames.count > 0)
+                    {
+                        const unsigned int frame_index = r_animation_get_frame_index(rs, animation, r_element_animation_get_elapsed_ms(rs, element_animation));
+                        const r_animation_frame_t *animation_frame = r_animation_frame_list_get_index(rs, &animation->frames, frame_index);
+
+                        status = r_video_draw_image_internal(rs, (r_image_t*)animation_frame->image.value.object, &transform, element_color, R_FALSE, 0, 0, 1, 1);
+                    }
+                }
+                break;
+
+            case R_ELEMENT_TYPE_TEXT:
+                /* Draw text using its cached glyph geometry (each glyph covers [x, x + 1] x [0, 1]) */
+                {
+                    r_element_text_t *element_text = (r_element_text_t*)element;
+                    r_image_t *image = (r_image_t*)element->image.value.object;
+
+                    status = r_element_text_glyphs_build(rs, element_text);
+
+                    if (R_SUCCEEDED(status))
+                    {
+                        unsigned int i;
+
+                        for (i = 0; i < element_text->glyph_count && R_SUCCEEDED(status); ++i)
+                        {
+                            const r_glyph_t *glyph = &element_text->glyphs[i];
+
+                            if (image->storage_type != R_IMAGE_STORAGE_COMPOSITE)
+                            {
+                                status = r_video_batch_add_image_quad(rs, image, &transform, element_color, glyph->x, 1, glyph->x + 1, 0, glyph->u1, glyph->v1, glyph->u2, glyph->v2);
+                            }
+                            else
+                            {
+                                r_transform2d_t glyph_transform;
+
+                                r_transform2d_copy(&glyph_transform, &transform);
+                                r_video_transform_translate(&glyph_transform, glyph->x + 0.5f, 0.5f);
+                                status = r_video_draw_image_internal(rs, image, &glyph_transform, element_color, R_TRUE, glyph->u1, glyph->v1, glyph->u2, glyph->v2);
+                            }
+                        }
+                    }
+                }
+                break;
+
+            case R_ELEMENT_TYPE_PARTICLE_EMITTER:
+                status = r_video_draw_particle_emitter(rs, (r_element_particle_emitter_t*)element, entity_transform, element_color);
+                break;
+
+            case R_ELEMENT_TYPE_TILEMAP:
+                status = r_video_draw_tilemap(rs, (r_element_tilemap_t*)element, &transform, element_color);
+                break;
+
+            default:
+                status = R_VIDEO_FAILURE;
+            }
+        }
+    }
+
+    return status;
+}
+
+/* Checks to see if an entity's elements are entirely outside of the view (children are checked separately) */
+static r_boolean_t r_video_entity_is_culled(r_state_t *rs, r_element_list_t *element_list, r_transform2d_t *transform)
+{
+    r_boolean_t bounded = R_TRUE;
+    r_boolean_t culled = R_FALSE;
+    r_real_t x_min = 0;
+    r_real_t x_max = 0;
+    r_real_t y_min = 0;
+    r_real_t y_max = 0;
+    unsigned int i;
+
+    /* Find the bounds of the elements in the entity's coordinate space */
+    for (i = 0; i < element_list->zlist.object_list.count && bounded; ++i)
+    {
+        /* Assume the entity list is not locked (it shouldn't be when drawing) */
+        const r_element_t *element = (r_element_t*)element_list->zlist.object_list.items[i].object_ref.value.object;
+
+        switch (element->element_type)
+        {
+        case R_ELEMENT_TYPE_IMAGE:
+        case R_ELEMENT_TYPE_IMAGE_REGION:
+        case R_ELEMENT_TYPE_ANIMATION:
+            {
+                /* Use a square that contains the element at any rotation */
+                const r_real_t radius = (r_real_t)(sqrt(element->width * element->width + element->height * element->height) / 2);
+
+                x_min = (i == 0) ? (element->x - radius) : (R_MIN(x_min, element->x - radius));
+                x_max = (i == 0) ? (element->x + radius) : (R_MAX(x_max, element->x + radius));
+                y_min = (i == 0) ? (element->y - radius) : (R_MIN(y_min, element->y - radius));
+                y_max = (i == 0) ? (element->y + radius) : (R_MAX(y_max, element->y + radius));
+            }
+            break;
+
+        default:
+            /* The extent of text, particles, and tilemaps isn't cheap to determine, so they are never culled */
+            bounded = R_FALSE;
+            break;
+        }
+    }
+
+    if (bounded)
+    {
+        /* Compare the (axis-aligned) absolute bounds with the view */
+        const r_real_t view_half_height = (r_real_t)(R_VIDEO_HEIGHT / 2);
+        const r_real_t view_half_width = view_half_height * rs->video_width / rs->video_height;
+        const r_real_t local_x = (x_min + x_max) / 2;
+        const r_real_t local_y = (y_min + y_max) / 2;
+        const r_real_t local_half_width = (x_max - x_min) / 2;
+        const r_real_t local_half_height = (y_max - y_min) / 2;
+        const r_real_t x = (*transform)[0][0] * local_x + (*transform)[0][1] * local_y + (*transform)[0][2];
+        const r_real_t y = (*transform)[1][0] * local_x + (*transform)[1][1] * local_y + (*transform)[1][2];
+        const r_real_t half_width = (r_real_t)(fabs((*transform)[0][0]) * local_half_width + fabs((*transform)[0][1]) * local_half_height);
+        const r_real_t half_height = (r_real_t)(fabs((*transform)[1][0]) * local_half_width + fabs((*transform)[1][1]) * local_half_height);
+
+        culled = (x + half_width < -view_half_width
+                  || x - half_width > view_half_width
+                  || y + half_height < -view_half_height
+                  || y - half_height > view_half_height) ? R_TRUE : R_FALSE;
+    }
+
+    return culled;
+}
+
+static r_status_t r_video_draw_entity_list(r_state_t *rs, r_entity_list_t *entity_list, r_transform2d_t *parent_transform, r_boolean_t parent_exact, const GLfloat *parent_color);
+
+/* Hash used for cached bitmap signatures (FNV-1a) */
+R_INLINE unsigned int r_video_hash(unsigned int hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619;
+    }
+
+    return hash;
+}
+
+R_INLINE unsigned int r_video_hash_color(unsigned int hash, const r_color_t *color)
+{
+    if (color != NULL)
+    {
+        const r_real_t values[4] = { color->red, color->green, color->blue, color->opacity };
+
+        hash = r_video_hash(hash, values, sizeof(values));
+    }
+
+    return hash;
+}
+
+R_INLINE r_boolean_t r_video_color_is_opaque(const r_color_t *color)
+{
+    return (color == NULL || color->opacity >= 1) ? R_TRUE : R_FALSE;
+}
+
+R_INLINE r_boolean_t r_video_entity_is_interpolated(r_state_t *rs, r_entity_t *entity)
+{
+    return (r_video_interpolation < 1 && entity->previous_valid && entity->previous_step == rs->update_step) ? R_TRUE : R_FALSE;
+}
+
+/* Updates a signature of everything that affects how an entity's subtree is drawn (transformations, colors, element
+ * lists, and element properties); subtrees that change on their own (animations, particles, tilemaps, and
+ * interpolated entities) can't be cached, so R_FALSE is returned in that case (as it is for translucent colors when
+ * alpha can't be blended separately) */
+static r_boolean_t r_video_bitmap_cache_sign(r_state_t *rs, r_entity_t *entity, unsigned int *signature)
+{
+    r_element_list_t *element_list = (r_element_list_t*)entity->elements.value.object;
+    r_boolean_t cacheable = !r_video_entity_is_interpolated(rs, entity);
+    unsigned int hash = *signature;
+
+    hash = r_video_hash(hash, &entity, sizeof(entity));
+    hash = r_video_hash(hash, &entity->version, sizeof(entity->version));
+    hash = r_video_hash(hash, &element_list, sizeof(element_list));
+    hash = r_video_hash_color(hash, (r_color_t*)entity->color.value.object);
+
+    if (r_video_gl_blend_func_separate == NULL && !r_video_color_is_opaque((r_color_t*)entity->color.value.object))
+    {
+        cacheable = R_FALSE;
+    }
+
+    if (element_list != NULL)
+    {
+        unsigned int i;
+
+        hash = r_video_hash(hash, &element_list->zlist.object_list.count, sizeof(element_list->zlist.object_list.count));
+
+        for (i = 0; i < element_list->zlist.object_list.count && cacheable; ++i)
+        {
+            r_element_t *element = (r_element_t*)element_list->zlist.object_list.items[i].object_ref.value.object;
+            const r_real_t values[5] = { element->x, element->y, element->width, element->height, element->angle };
+
+            hash = r_video_hash(hash, &element, sizeof(element));
+            hash = r_video_hash(hash, values, sizeof(values));
+            hash = r_video_hash(hash, &element->image.value.object, sizeof(element->image.value.object));
+            hash = r_video_hash_color(hash, (r_color_t*)element->color.value.object);
+
+            switch (element->element_type)
+            {
+            case R_ELEMENT_TYPE_IMAGE:
+                break;
+
+            case R_ELEMENT_TYPE_IMAGE_REGION:
+                {
+                    r_element_image_region_t *element_image_region = (r_element_image_region_t*)element;
+                    const r_real_t region[4] = { element_image_region->u1, element_image_region->v1, element_image_region->u2, element_image_region->v2 };
+
+                    hash = r_video_hash(hash, region, sizeof(region));
+                }
+                break;
+
+            case R_ELEMENT_TYPE_TEXT:
+                {
+                    r_element_text_t *element_text = (r_element_text_t*)element;
+
+                    cacheable = R_SUCCEEDED(r_element_text_glyphs_build(rs, element_text)) ? R_TRUE : R_FALSE;
+
+                    if (cacheable)
+                    {
+                        hash = r_video_hash(hash, &element_text->glyph_count, sizeof(element_text->glyph_count));
+                        hash = r_video_hash(hash, element_text->glyphs, element_text->glyph_count * sizeof(r_glyph_t));
+                    }
+                }
+                break;
+
+            default:
+                cacheable = R_FALSE;
+                break;
+            }
+
+            if (r_video_gl_blend_func_separate == NULL && !r_video_color_is_opaque((r_color_t*)element->color.value.object))
+            {
+                cacheable = R_FALSE;
+            }
+        }
+    }
+
+    if (cacheable && entity->has_children)
+    {
+        unsigned int i;
+
+        for (i = 0; i < entity->children_display.object_list.count && cacheable; ++i)
+        {
+            cacheable = r_video_bitmap_cache_sign(rs, (r_entity_t*)entity->children_display.object_list.items[i].object_ref.value.object, &hash);
+        }
+    }
+
+    *signature = hash;
+
+    return cacheable;
+}
+
+static void r_video_bitmap_cache_release(r_state_t *rs, r_video_bitmap_cache_t *bitmap_cache)
+{
+    if (bitmap_cache->texture != 0)
+    {
+        /* Deleting a bound texture unbinds it (and its name may be reused) */
+        glDeleteTextures(1, &bitmap_cache->texture);
+        bitmap_cache->texture = 0;
+        r_video_bound_texture_valid = R_FALSE;
+    }
+
+    bitmap_cache->valid = R_FALSE;
+}
 
-                    /* Use the given texture */
-                    glBindTexture(GL_TEXTURE_2D, (GLuint)(element->id));
+void r_video_bitmap_caches_release(r_state_t *rs)
+{
+    r_video_bitmap_cache_t *bitmap_cache;
 
-                    /* Draw the rectangle */
-                    glBegin(GL_POLYGON);
-                    glTexCoord2f(element_u1 * element_x2, element_v1 * element_y2);
-                    glVertex3f(x1, y1, 0.0f);
+    for (bitmap_cache = r_video_bitmap_caches; bitmap_cache != NULL; bitmap_cache = bitmap_cache->next)
+    {
+        r_video_bitmap_cache_release(rs, bitmap_cache);
+    }
 
-                    glTexCoord2f(element_u1 * element_x2, element_v2 * element_y2);
-                    glVertex3f(x1, y2, 0.0f);
+    if (r_video_framebuffer != 0)
+    {
+        if (r_video_framebuffer_supported)
+        {
+            r_video_gl_delete_framebuffers(1, &r_video_framebuffer);
+        }
 
-                    glTexCoord2f(element_u2 * element_x2, element_v2 * element_y2);
-                    glVertex3f(x2, y2, 0.0f);
+        r_video_framebuffer = 0;
+    }
+}
 
-                    glTexCoord2f(element_u2 * element_x2, element_v1 * element_y2);
-                    glVertex3f(x2, y1, 0.0f);
-                    glEnd();
+void r_video_bitmap_cache_free(r_state_t *rs, void *bitmap_cache)
+{
+    r_video_bitmap_cache_t *cache = (r_video_bitmap_cache_t*)bitmap_cache;
 
-                    /* Move to the next element's area */
-                    x1 = x2;
-                }
+    if (cache != NULL)
+    {
+        r_video_bitmap_cache_release(rs, cache);
 
-                /* Move to the next element's area */
-                y1 = y2;
-            }
+        if (cache->previous != NULL)
+        {
+            cache->previous->next = cache->next;
+        }
+        else
+        {
+            r_video_bitmap_caches = cache->next;
+        }
 
-            glPopMatrix();
+        if (cache->next != NULL)
+        {
+            cache->next->previous = cache->previous;
         }
-        break;
 
-    default:
-        R_ASSERT(0); /* Unsupported storage type */
-        break;
+        free(cache);
     }
-
-    return r_glenum_to_status(glGetError());
 }
 
-static r_status_t r_video_draw_element(r_state_t *rs, r_element_t *element)
+/* Draws an entity's elements and children (after its transformation and color have been determined) */
+static r_status_t r_video_draw_entity_contents(r_state_t *rs, r_entity_t *entity, r_element_list_t *element_list, r_transform2d_t *transform, r_boolean_t exact, const GLfloat *color)
 {
-    r_status_t status = (element != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
-    R_ASSERT(R_SUCCEEDED(status));
+    r_status_t status = R_SUCCESS;
 
-    if (R_SUCCEEDED(status))
+    /* Skip elements that are entirely outside of the view */
+    const unsigned int element_count = r_video_entity_is_culled(rs, element_list, transform) ? 0 : element_list->zlist.object_list.count;
+    unsigned int i;
+
+    /* Draw all elements */
+    for (i = 0; i < element_count && R_SUCCEEDED(status); ++i)
     {
-        /* Common element setup */
-        r_color_t color_base;
-        r_color_t *color = (r_color_t*)element->color.value.object;
-        r_boolean_t visible = R_TRUE;
+        /* Assume the entity list is not locked (it shouldn't be when drawing) */
+        r_element_t *element = (r_element_t*)element_list->zlist.object_list.items[i].object_ref.value.object;
 
-        r_video_color_get_current_color(&color_base);
-        visible = (color_base.opacity > 0);
+        status = r_video_draw_element(rs, element, transform, color);
+    }
 
-        if (color != NULL)
+    /* Draw children, if necessary */
+    if (R_SUCCEEDED(status))
+    {
+        if (entity->has_children && entity->children_display.object_list.count > 0)
         {
-            r_video_color_blend(&color_base, color);
-            visible = visible && (color->opacity > 0);
+            status = r_video_draw_entity_list(rs, &entity->children_display, transform, exact, color);
         }
+    }
+
+    return status;
+}
+
+/* Renders an entity's subtree into a bitmap covering the view (using a framebuffer object if possible; otherwise the
+ * back buffer is used and then copied, so the scene must be redrawn) */
+static r_status_t r_video_bitmap_cache_render(r_state_t *rs, r_video_bitmap_cache_t *bitmap_cache, r_entity_t *entity, r_element_list_t *element_list, r_transform2d_t *transform, r_boolean_t exact)
+{
+    r_status_t status = r_video_batch_flush(rs);
+
+    if (R_SUCCEEDED(status) && bitmap_cache->texture == 0)
+    {
+        glGenTextures(1, &bitmap_cache->texture);
+        r_video_gl_bind_texture(bitmap_cache->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, rs->video_full_featured ? GL_CLAMP_TO_EDGE : GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, rs->video_full_featured ? GL_CLAMP_TO_EDGE : GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmap_cache->texture_width, bitmap_cache->texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        status = r_video_gl_check();
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        r_boolean_t framebuffer = R_FALSE;
 
-        if (element->image.value.object != NULL && visible)
+        if (r_video_framebuffer_supported)
         {
-            glPushMatrix();
-            glTranslatef(element->x, element->y, 0);
-            glRotatef(element->angle, 0, 0, 1);
-            glScalef(element->width, element->height, 0);
+            if (r_video_framebuffer == 0)
+            {
+                r_video_gl_gen_framebuffers(1, &r_video_framebuffer);
+            }
 
-            switch (element->element_type)
+            r_video_gl_bind_framebuffer(GL_FRAMEBUFFER_EXT, r_video_framebuffer);
+            r_video_gl_framebuffer_texture_2d(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, bitmap_cache->texture, 0);
+            framebuffer = (r_video_gl_check_framebuffer_status(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT) ? R_TRUE : R_FALSE;
+
+            if (!framebuffer)
             {
-            case R_ELEMENT_TYPE_IMAGE:
-                status = r_video_draw_image_internal(rs, (r_image_t*)element->image.value.object, R_FALSE, 0, 0, 1, 1);
-                break;
+                /* Don't try again (bitmaps are copied from the back buffer from now on, if possible) */
+                r_video_gl_bind_framebuffer(GL_FRAMEBUFFER_EXT, 0);
+                r_video_gl_delete_framebuffers(1, &r_video_framebuffer);
+                r_video_framebuffer = 0;
+                r_video_framebuffer_supported = R_FALSE;
+            }
+        }
 
-            case R_ELEMENT_TYPE_IMAGE_REGION:
-                {
-                    /* TODO: Coordinate checks could go in the "set" functions */
-                    const r_element_image_region_t *element_image_region = (r_element_image_region_t*)element;
-                    r_image_t *image = (r_image_t*)element->image.value.object;
-                    r_real_t u1 = R_MAX(0, element_image_region->u1);
-                    r_real_t v1 = R_MAX(0, element_image_region->v1);
-                    r_real_t u2 = R_MIN(1, element_image_region->u2);
-                    r_real_t v2 = R_MIN(1, element_image_region->v2);
+        /* Draw the subtree (without inherited color) onto a transparent background; alpha is accumulated separately
+         * so that the bitmap's alpha is correct for its premultiplied colors (otherwise only opaque subtrees are cached) */
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(0, 0, 0, 1);
 
-                    /* Sanity-check the texture coordinates */
-                    if (u1 < 0 || v1 < 0 || u2 > 1 || v2 > 1 || u1 >= u2 || v1 >= v2)
-                    {
-                        status = RV_F_BAD_COORDINATES;
-                    }
+        if (r_video_gl_blend_func_separate != NULL)
+        {
+            r_video_gl_blend_func_separate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        }
 
-                    if (R_SUCCEEDED(status))
-                    {
-                        status = r_video_draw_image_internal(rs, image, R_TRUE, u1, v1, u2, v2);
-                    }
-                }
-                break;
+        {
+            const GLfloat white[4] = { 1, 1, 1, 1 };
+            GLfloat color[4];
 
-            case R_ELEMENT_TYPE_ANIMATION:
-                {
-                    /* Draw the current frame */
-                    const r_element_animation_t *element_animation = (r_element_animation_t*)element;
-                    const r_animation_t *animation = (r_animation_t*)element->image.value.object;
-                    const unsigned int frame_index = element_animation->frame_index;
+            r_video_color_blend(color, white, (r_color_t*)entity->color.value.object);
+            r_video_bitmap_cache_rendering = R_TRUE;
+            status = r_video_draw_entity_contents(rs, entity, element_list, transform, exact, color);
+            r_video_bitmap_cache_rendering = R_FALSE;
+        }
 
-                    if (frame_index < animation->frames.count)
-                    {
-                        const r_animation_frame_t *animation_frame = r_animation_frame_list_get_index(rs, &animation->frames, frame_index);
+        if (R_SUCCEEDED(status))
+        {
+            status = r_video_batch_flush(rs);
+        }
 
-                        status = r_video_draw_image_internal(rs, (r_image_t*)animation_frame->image.value.object, R_FALSE, 0, 0, 1, 1);
-                    }
-                }
-                break;
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-            case R_ELEMENT_TYPE_TEXT:
-                /* Draw text, one character at a time */
-                {
-                    r_element_text_t *element_text = (r_element_text_t*)element;
-                    r_image_t *image = (r_image_t*)element->image.value.object;
-                    const char *pc = NULL;
-                    int length = -1;
+        if (framebuffer)
+        {
+            r_video_gl_bind_framebuffer(GL_FRAMEBUFFER_EXT, 0);
+        }
+        else
+        {
+            r_video_gl_bind_texture(bitmap_cache->texture);
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, rs->video_width, rs->video_height);
+            r_video_bitmap_cache_redraw = R_TRUE;
+        }
 
-                    /* If text is provided, use it; otherwise check for an underlying string buffer */
-                    if (element_text->text.value.str != NULL)
-                    {
-                        pc = element_text->text.value.str;
-                    }
-                    else if (element_text->buffer.value.object != NULL && element_text->buffer.value.object->header->type == R_OBJECT_TYPE_STRING_BUFFER)
-                    {
-                        r_string_buffer_t *string_buffer = (r_string_buffer_t*)element_text->buffer.value.object;
+        if (R_SUCCEEDED(status))
+        {
+            status = r_video_gl_check();
+        }
+    }
 
-                        if (string_buffer->buffer != NULL)
-                        {
-                            pc = string_buffer->buffer;
-                            length = string_buffer->length;
-                        }
-                    }
+    return status;
+}
 
-                    if (pc != NULL)
-                    {
-                        /* Determine length, if not already given */
-                        if (length == -1)
-                        {
-                            /* TODO: C-style string length could be cached */
-                            length = strlen(pc);
-                        }
+/* Draws an entity's subtree from its cached bitmap, rendering the bitmap first if the subtree has changed; drawn is
+ * set to R_FALSE if the subtree can't be cached (and should be drawn normally) */
+static r_status_t r_video_draw_entity_cached(r_state_t *rs, r_entity_t *entity, r_element_list_t *element_list, r_transform2d_t *transform, r_boolean_t exact, const GLfloat *parent_color, r_boolean_t *drawn)
+{
+    r_status_t status = R_SUCCESS;
+    unsigned int texture_width = 1;
+    unsigned int texture_height = 1;
+    unsigned int signature = 2166136261u;
+    r_boolean_t cacheable = R_FALSE;
 
-                        /* Adjust position for alignment */
-                        switch (element_text->alignment)
-                        {
-                        case R_ELEMENT_TEXT_ALIGNMENT_LEFT:
-                            /* No adjustment needed for left alignment */
-                            break;
-
-                        case R_ELEMENT_TEXT_ALIGNMENT_CENTER:
-                            glTranslatef(-((r_real_t)length) / 2, 0, 0);
-                            break;
-
-                        case R_ELEMENT_TEXT_ALIGNMENT_RIGHT:
-                            glTranslatef(-((r_real_t)length), 0, 0);
-                            break;
-
-                        default:
-                            R_ASSERT(0);
-                            status = R_F_INVALID_INDEX;
-                            break;
-                        }
+    /* Textures cover the view (rounding up to powers of two, if necessary) */
+    if (rs->video_npot_textures)
+    {
+        texture_width = rs->video_width;
+        texture_height = rs->video_height;
+    }
+    else
+    {
+        while (texture_width < rs->video_width)
+        {
+            texture_width <<= 1;
+        }
 
-                        if (R_SUCCEEDED(status))
-                        {
-                            glTranslatef(0.5f, 0.5f, 0);
+        while (texture_height < rs->video_height)
+        {
+            texture_height <<= 1;
+        }
+    }
 
-                            /* Draw each character */
-                            for (; *pc != '\0' && R_SUCCEEDED(status); ++pc)
-                            {
-                                /* Characters in a font are stored in a 12x8 table */
-                                r_font_coordinates_t *fc = &r_font_coordinates[(unsigned char)(*pc)];
+    /* Bitmaps are rendered into framebuffer objects or copied from a back buffer that has destination alpha */
+    if ((r_video_framebuffer_supported || r_video_back_buffer_alpha)
+        && texture_width <= rs->max_texture_size
+        && texture_height <= rs->max_texture_size)
+    {
+        signature = r_video_hash(signature, transform, sizeof(r_transform2d_t));
+        cacheable = r_video_bitmap_cache_sign(rs, entity, &signature);
+    }
 
-                                status = r_video_draw_image_internal(rs, image, R_TRUE, fc->x_min, fc->y_min, fc->x_max, fc->y_max);
-                                glTranslatef(1, 0, 0);
-                            }
+    if (cacheable)
+    {
+        r_video_bitmap_cache_t *bitmap_cache = (r_video_bitmap_cache_t*)entity->bitmap_cache;
 
-                            glTranslatef(-0.5f, -0.5f, 0);
-                        }
-                    }
+        if (bitmap_cache == NULL)
+        {
+            bitmap_cache = (r_video_bitmap_cache_t*)malloc(sizeof(r_video_bitmap_cache_t));
+            status = (bitmap_cache != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+            if (R_SUCCEEDED(status))
+            {
+                bitmap_cache->previous = NULL;
+                bitmap_cache->next = r_video_bitmap_caches;
+                bitmap_cache->valid = R_FALSE;
+                bitmap_cache->signature = 0;
+                bitmap_cache->texture = 0;
+                bitmap_cache->texture_width = texture_width;
+                bitmap_cache->texture_height = texture_height;
+
+                if (r_video_bitmap_caches != NULL)
+                {
+                    r_video_bitmap_caches->previous = bitmap_cache;
                 }
-                break;
 
-            default:
-                status = R_VIDEO_FAILURE;
+                r_video_bitmap_caches = bitmap_cache;
+                entity->bitmap_cache = (void*)bitmap_cache;
             }
+        }
 
-            glPopMatrix();
+        if (R_SUCCEEDED(status) && (bitmap_cache->texture_width != texture_width || bitmap_cache->texture_height != texture_height))
+        {
+            r_video_bitmap_cache_release(rs, bitmap_cache);
+            bitmap_cache->texture_width = texture_width;
+            bitmap_cache->texture_height = texture_height;
+        }
+
+        if (R_SUCCEEDED(status) && (!bitmap_cache->valid || bitmap_cache->signature != signature))
+        {
+            status = r_video_bitmap_cache_render(rs, bitmap_cache, entity, element_list, transform, exact);
+
+            if (R_SUCCEEDED(status))
+            {
+                bitmap_cache->valid = R_TRUE;
+                bitmap_cache->signature = signature;
+            }
         }
 
-        if (color != NULL)
+        if (R_SUCCEEDED(status))
         {
-            r_video_color_unblend(&color_base);
+            status = r_video_batch_flush(rs);
         }
 
         if (R_SUCCEEDED(status))
         {
-            status = (glGetError() == 0) ? R_SUCCESS : R_VIDEO_FAILURE;
+            /* The bitmap's colors are already multiplied by its alpha, so it is tinted and blended accordingly */
+            const GLfloat y = (GLfloat)(R_VIDEO_HEIGHT / 2);
+            const GLfloat x = y * rs->video_width / rs->video_height;
+            const GLfloat u = ((GLfloat)rs->video_width) / texture_width;
+            const GLfloat v = ((GLfloat)rs->video_height) / texture_height;
+
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            glColor4f(parent_color[0] * parent_color[3], parent_color[1] * parent_color[3], parent_color[2] * parent_color[3], parent_color[3]);
+            r_video_gl_bind_texture(bitmap_cache->texture);
+
+            glBegin(GL_QUADS);
+            glTexCoord2f(0, v); glVertex2f(-x, y);
+            glTexCoord2f(0, 0); glVertex2f(-x, -y);
+            glTexCoord2f(u, 0); glVertex2f(x, -y);
+            glTexCoord2f(u, v); glVertex2f(x, y);
+            glEnd();
+            r_video_statistics_add_draw(4);
+
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+            /* Blending (twice) and color */
+            r_video_statistics_add_state_changes(3);
+            status = r_video_gl_check();
         }
     }
 
+    *drawn = cacheable;
+
     return status;
 }
 
-static r_status_t r_video_draw_entity_list(r_state_t *rs, r_entity_list_t *entity_list);
-
-static r_status_t r_video_draw_entity(r_state_t *rs, r_entity_t *entity)
+static r_status_t r_video_draw_entity(r_state_t *rs, r_entity_t *entity, r_transform2d_t *parent_transform, r_boolean_t parent_exact, const GLfloat *parent_color)
 {
     /* Set up transformations */
     r_status_t status = R_SUCCESS;
@@ -846,65 +2263,73 @@ static r_status_t r_video_draw_entity(r_state_t *rs, r_entity_t *entity)
 
     if (element_list != NULL)
     {
-        r_color_t color_base;
-        r_color_t *color = (r_color_t*)entity->color.value.object;
-        r_boolean_t visible = R_TRUE;
+        /* Fully transparent entities (and their children) are skipped */
+        GLfloat color[4];
 
-        r_video_color_get_current_color(&color_base);
-        visible = (color_base.opacity > 0);
+        r_video_color_blend(color, parent_color, (r_color_t*)entity->color.value.object);
 
-        if (color != NULL)
+        if (color[3] > 0)
         {
-            r_video_color_blend(&color_base, color);
-            visible = visible && (color->opacity > 0);
-        }
+            /* The entity's cached absolute transformation is used unless it (or an ancestor) is being interpolated */
+            r_transform2d_t composed_transform;
+            r_transform2d_t *transform = &composed_transform;
+            r_boolean_t exact = R_FALSE;
 
-        if (visible)
-        {
-            glPushMatrix();
-            glTranslatef(entity->x, entity->y, 0);
-            glRotatef(entity->angle, 0, 0, 1);
-            glScalef(entity->width, entity->height, 0);
+            if (r_video_entity_is_interpolated(rs, entity))
+            {
+                /* Entity changed during the last update step, so interpolate (taking the shortest path for rotation) */
+                const r_real_t t = r_video_interpolation;
+                r_real_t angle_difference = (r_real_t)fmod(entity->angle - entity->previous_angle, 360);
+
+                if (angle_difference > 180)
+                {
+                    angle_difference -= 360;
+                }
+                else if (angle_difference < -180)
+                {
+                    angle_difference += 360;
+                }
 
-            /* TODO: Call glGetError at appropriate places everywhere */
-            status = (glGetError() == 0) ? R_SUCCESS : R_VIDEO_FAILURE;
+                r_video_transform_compose(&composed_transform, parent_transform,
+                                          entity->previous_x + t * (entity->x - entity->previous_x),
+                                          entity->previous_y + t * (entity->y - entity->previous_y),
+                                          entity->previous_angle + t * angle_difference,
+                                          entity->previous_width + t * (entity->width - entity->previous_width),
+                                          entity->previous_height + t * (entity->height - entity->previous_height));
+            }
+            else if (parent_exact && entity->width != 0 && entity->height != 0)
+            {
+                /* Note: the cached transformation is computed by inversion, so it isn't used for degenerate scales */
+                status = r_entity_get_absolute_transform(rs, entity, &transform);
+                exact = R_TRUE;
+            }
+            else
+            {
+                r_video_transform_compose(&composed_transform, parent_transform, entity->x, entity->y, entity->angle, entity->width, entity->height);
+            }
 
             if (R_SUCCEEDED(status))
             {
-                unsigned int i;
+                /* Entities marked to be cached as bitmaps are drawn in one quad (unless they are part of another cached subtree) */
+                r_boolean_t drawn = R_FALSE;
 
-                /* Draw all elements */
-                for (i = 0; i < element_list->object_list.count && R_SUCCEEDED(status); ++i)
+                if (entity->cache_as_bitmap && !r_video_bitmap_cache_rendering)
                 {
-                    /* Assume the entity list is not locked (it shouldn't be when drawing) */
-                    r_element_t *element = (r_element_t*)element_list->object_list.items[i].object_ref.value.object;
-
-                    status = r_video_draw_element(rs, element);
+                    status = r_video_draw_entity_cached(rs, entity, element_list, transform, exact, parent_color, &drawn);
                 }
 
-                /* Draw children, if necessary */
-                if (R_SUCCEEDED(status))
+                if (R_SUCCEEDED(status) && !drawn)
                 {
-                    if (entity->has_children && entity->children_display.object_list.count > 0)
-                    {
-                        status = r_video_draw_entity_list(rs, &entity->children_display);
-                    }
+                    status = r_video_draw_entity_contents(rs, entity, element_list, transform, exact, color);
                 }
             }
-
-            glPopMatrix();
-        }
-
-        if (color != NULL)
-        {
-            r_video_color_unblend(&color_base);
         }
     }
 
     return status;
 }
 
-static r_status_t r_video_draw_entity_list(r_state_t *rs, r_entity_list_t *entity_list)
+static r_status_t r_video_draw_entity_list(r_state_t *rs, r_entity_list_t *entity_list, r_transform2d_t *parent_transform, r_boolean_t parent_exact, const GLfloat *parent_color)
 {
     r_status_t status = (entity_list != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
     R_ASSERT(R_SUCCEEDED(status));
@@ -921,7 +2346,7 @@ static r_status_t r_video_draw_entity_list(r_state_t *rs, r_entity_list_t *entit
             r_object_ref_t *entity_ref = &entity_list->object_list.items[i].object_ref;
             r_entity_t *entity = (r_entity_t*)entity_ref->value.object;
 
-            status = r_video_draw_entity(rs, entity);
+            status = r_video_draw_entity(rs, entity, parent_transform, parent_exact, parent_color);
         }
     }
 
@@ -1071,6 +2496,72 @@ static r_status_t r_video_draw_collision_detector(r_state_t *rs, r_collision_det
     return status;
 }
 
+/* Profiler overlay scale (in coordinate units per millisecond) and colors for each phase (in the order of r_profiler_phase_t) */
+#define R_VIDEO_PROFILER_SCALE  4.0f
+
+static const GLfloat r_video_profiler_colors[R_PROFILER_PHASE_MAX][3] = {
+    { 0.5f,  0.5f,  0.5f  },
+    { 0.0f,  0.75f, 0.75f },
+    { 1.0f,  0.75f, 0.0f  },
+    { 0.25f, 1.0f,  0.25f },
+    { 0.5f,  0.25f, 1.0f  },
+    { 1.0f,  0.25f, 0.25f },
+    { 0.25f, 0.5f,  1.0f  },
+    { 1.0f,  1.0f,  1.0f  },
+    { 1.0f,  0.25f, 1.0f  },
+    { 0.75f, 0.5f,  0.25f },
+    { 0.0f,  0.0f,  0.0f  }
+};
+
+static r_status_t r_video_draw_profiler_overlay(r_state_t *rs, r_profiler_t *profiler)
+{
+    /* Draw a stacked bar of phase times for each recorded frame along the bottom of the screen (idle time is omitted) */
+    const GLfloat view_half_height = (GLfloat)(R_VIDEO_HEIGHT / 2);
+    const GLfloat view_half_width = view_half_height * rs->video_width / rs->video_height;
+    const GLfloat bar_width = 2 * view_half_width / profiler->frame_count;
+    unsigned int i;
+
+    glDisable(GL_TEXTURE_2D);
+    glBegin(GL_QUADS);
+
+    for (i = 0; i < profiler->recorded_frames; ++i)
+    {
+        const r_profiler_frame_t *frame = r_profiler_get_frame(rs, profiler, i);
+        const GLfloat x1 = -view_half_width + (profiler->frame_count - profiler->recorded_frames + i) * bar_width;
+        const GLfloat x2 = x1 + bar_width;
+        GLfloat y1 = -view_half_height;
+        int j;
+
+        for (j = 0; j < R_PROFILER_PHASE_MAX; ++j)
+        {
+            if (j != R_PROFILER_PHASE_IDLE)
+            {
+                const GLfloat y2 = y1 + (GLfloat)frame->phase_ms[j] * R_VIDEO_PROFILER_SCALE;
+
+                glColor4f(r_video_profiler_colors[j][0], r_video_profiler_colors[j][1], r_video_profiler_colors[j][2], 0.75f);
+                glVertex3f(x1, y1, 0.0f);
+                glVertex3f(x2, y1, 0.0f);
+                glVertex3f(x2, y2, 0.0f);
+                glVertex3f(x1, y2, 0.0f);
+
+                y1 = y2;
+            }
+        }
+    }
+
+    glEnd();
+
+    /* Mark the 60 Hz frame period */
+    glColor4f(1.0f, 1.0f, 1.0f, 0.5f);
+    glBegin(GL_LINES);
+    glVertex3f(-view_half_width, -view_half_height + (1000.0f / 60) * R_VIDEO_PROFILER_SCALE, 0.0f);
+    glVertex3f(view_half_width, -view_half_height + (1000.0f / 60) * R_VIDEO_PROFILER_SCALE, 0.0f);
+    glEnd();
+    glEnable(GL_TEXTURE_2D);
+
+    return R_SUCCESS;
+}
+
 r_status_t r_video_draw(r_state_t *rs)
 {
     r_status_t status = (rs != NULL && rs->script_state != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
@@ -1093,12 +2584,33 @@ r_status_t r_video_draw(r_state_t *rs)
         r_capture_t *capture = (r_capture_t*)rs->capture;
 
         /* For now, ignore capture errors */
+        r_profiler_push(rs, R_PROFILER_PHASE_CAPTURE);
         r_capture_write_video_packet(rs, capture);
+        r_profiler_pop(rs);
+    }
+
+    /* Display the previous frame, if its buffer swap was deferred (note: it is still in the back buffer when captured) */
+    if (R_SUCCEEDED(status) && r_video_swap_pending)
+    {
+        r_profiler_push(rs, R_PROFILER_PHASE_SWAP);
+        r_video_swap_buffers(rs);
+        r_profiler_pop(rs);
+        r_video_swap_pending = R_FALSE;
     }
 
     /* Draw the scene */
     if (R_SUCCEEDED(status))
     {
+        r_boolean_t pipelined = R_FALSE;
+
+        r_profiler_push(rs, R_PROFILER_PHASE_DRAW);
+
+        r_video_statistics_frame.draw_calls = 0;
+        r_video_statistics_frame.texture_binds = 0;
+        r_video_statistics_frame.state_changes = 0;
+        r_video_statistics_frame.vertices = 0;
+        r_video_bound_texture_valid = R_FALSE;
+
         glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
         glLoadIdentity();
 
@@ -1115,9 +2627,38 @@ r_status_t r_video_draw(r_state_t *rs)
             {
                 if (layer != NULL)
                 {
+                    /* Layers that wait for events before drawing again must display each frame immediately */
+                    pipelined = (rs->video_pipelined && layer->frame_period_ms > 0) ? R_TRUE : R_FALSE;
+                    r_video_interpolation = (layer->update_period_ms > 0 && layer->interpolate) ? layer->interpolation : 1;
+                    r_video_batch_quad_count = 0;
+                    r_video_batch_run_count = 0;
+
                     if (layer->entities_display.object_list.count > 0)
                     {
-                        status = r_video_draw_entity_list(rs, &layer->entities_display);
+                        const GLfloat white[4] = { 1, 1, 1, 1 };
+                        r_transform2d_t identity;
+                        unsigned int pass;
+
+                        r_transform2d_init(&identity);
+
+                        /* Rendering a cached bitmap without a framebuffer object overwrites the back buffer, so the scene is drawn again in that case */
+                        r_video_bitmap_cache_redraw = R_FALSE;
+
+                        for (pass = 0; pass < 2 && (pass == 0 || r_video_bitmap_cache_redraw) && R_SUCCEEDED(status); ++pass)
+                        {
+                            if (pass > 0)
+                            {
+                                r_video_bitmap_cache_redraw = R_FALSE;
+                                glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+                            }
+
+                            status = r_video_draw_entity_list(rs, &layer->entities_display, &identity, R_TRUE, white);
+
+                            if (R_SUCCEEDED(status))
+                            {
+                                status = r_video_batch_flush(rs);
+                            }
+                        }
                     }
 
                     if (R_SUCCEEDED(status) && layer->debug_collision_detectors)
@@ -1143,10 +2684,32 @@ r_status_t r_video_draw(r_state_t *rs)
             }
         }
 
-        /* Swap video buffers to display the scene */
+        /* Draw the profiler overlay, if enabled */
+        if (R_SUCCEEDED(status) && rs->profiler != NULL && ((r_profiler_t*)rs->profiler)->overlay)
+        {
+            status = r_video_draw_profiler_overlay(rs, (r_profiler_t*)rs->profiler);
+        }
+
+        /* Check for errors from any GL calls in this frame */
         if (R_SUCCEEDED(status))
         {
-            SDL_GL_SwapBuffers();
+            status = r_glenum_to_status(glGetError());
+        }
+
+        r_video_statistics_last = r_video_statistics_frame;
+        r_profiler_pop(rs);
+
+        /* Swap video buffers to display the scene (when pipelined, just submit the commands and swap before the next frame) */
+        if (R_SUCCEEDED(status) && pipelined)
+        {
+            glFlush();
+            r_video_swap_pending = R_TRUE;
+        }
+        else if (R_SUCCEEDED(status))
+        {
+            r_profiler_push(rs, R_PROFILER_PHASE_SWAP);
+            r_video_swap_buffers(rs);
+            r_profiler_pop(rs);
         }
     }
 
@@ -54,5 +54,9 @@ extern r_status_t r_video_setup(r_state_t *rs);
 /* Draw the scene */
 extern r_status_t r_video_draw(r_state_t *rs);
 
+/* Free an entity's cached bitmap, or release the textures of all cached bitmaps (they are rendered again when next drawn) */
+extern void r_video_bitmap_cache_free(r_state_t *rs, void *bitmap_cache);
+extern void r_video_bitmap_caches_release(r_state_t *rs);
+
 #endif
 
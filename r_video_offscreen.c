@@ -0,0 +1,146 @@
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+
+#ifdef R_VIDEO_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#include "r_assert.h"
+#include "r_log.h"
+#include "r_video_offscreen.h"
+
+#ifdef R_VIDEO_OSMESA
+typedef struct
+{
+    OSMesaContext   context;
+    unsigned int    width;
+    unsigned int    height;
+    unsigned char   *buffer;
+} r_video_offscreen_t;
+#endif
+
+r_boolean_t r_video_offscreen_is_supported()
+{
+#ifdef R_VIDEO_OSMESA
+    return R_TRUE;
+#else
+    return R_FALSE;
+#endif
+}
+
+r_status_t r_video_offscreen_set_mode(r_state_t *rs, unsigned int width, unsigned int height)
+{
+    r_status_t status = (rs != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
+    R_ASSERT(R_SUCCEEDED(status));
+
+#ifdef R_VIDEO_OSMESA
+    if (R_SUCCEEDED(status) && rs->video_offscreen_state == NULL)
+    {
+        r_video_offscreen_t *offscreen = (r_video_offscreen_t*)malloc(sizeof(r_video_offscreen_t));
+
+        status = (offscreen != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+        if (R_SUCCEEDED(status))
+        {
+            /* Match the windowed mode's framebuffer (RGBA with a depth buffer) */
+            offscreen->context = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+            offscreen->width = 0;
+            offscreen->height = 0;
+            offscreen->buffer = NULL;
+
+            status = (offscreen->context != NULL) ? R_SUCCESS : R_FAILURE;
+
+            if (R_SUCCEEDED(status))
+            {
+                rs->video_offscreen_state = (void*)offscreen;
+            }
+            else
+            {
+                r_log_error(rs, "Could not create offscreen OpenGL context");
+                free(offscreen);
+            }
+        }
+    }
+
+    if (R_SUCCEEDED(status))
+    {
+        r_video_offscreen_t *offscreen = (r_video_offscreen_t*)rs->video_offscreen_state;
+
+        if (offscreen->buffer == NULL || offscreen->width != width || offscreen->height != height)
+        {
+            unsigned char *buffer = (unsigned char*)realloc(offscreen->buffer, width * height * 4 * sizeof(unsigned char));
+
+            status = (buffer != NULL) ? R_SUCCESS : R_F_OUT_OF_MEMORY;
+
+            if (R_SUCCEEDED(status))
+            {
+                offscreen->buffer = buffer;
+                offscreen->width = width;
+                offscreen->height = height;
+            }
+        }
+
+        if (R_SUCCEEDED(status))
+        {
+            status = OSMesaMakeCurrent(offscreen->context, offscreen->buffer, GL_UNSIGNED_BYTE, (GLsizei)width, (GLsizei)height) ? R_SUCCESS : R_FAILURE;
+
+            if (R_FAILED(status))
+            {
+                r_log_error_format(rs, "Could not set offscreen video mode %ux%u", width, height);
+            }
+        }
+    }
+#else
+    if (R_SUCCEEDED(status))
+    {
+        status = R_F_NOT_IMPLEMENTED;
+    }
+#endif
+
+    return status;
+}
+
+void r_video_offscreen_end(r_state_t *rs)
+{
+#ifdef R_VIDEO_OSMESA
+    if (rs->video_offscreen_state != NULL)
+    {
+        r_video_offscreen_t *offscreen = (r_video_offscreen_t*)rs->video_offscreen_state;
+
+        OSMesaDestroyContext(offscreen->context);
+        free(offscreen->buffer);
+        free(offscreen);
+        rs->video_offscreen_state = NULL;
+    }
+#endif
+}
+
+void *r_video_offscreen_get_proc_address(const char *name)
+{
+#ifdef R_VIDEO_OSMESA
+    return (void*)OSMesaGetProcAddress(name);
+#else
+    return NULL;
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef __R_VIDEO_OFFSCREEN_H
+#define __R_VIDEO_OFFSCREEN_H
+
+/*
+Copyright 2012 Jared Krinke.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "r_defs.h"
+#include "r_state.h"
+
+/* Offscreen rendering lets headless runs draw every frame (e.g. for render benchmarks and capture on machines without a
+ * display or GPU); it renders with OSMesa and is only available when built using "--with-osmesa" */
+extern r_boolean_t r_video_offscreen_is_supported();
+
+/* Creates (or resizes) the offscreen framebuffer and makes its OpenGL context current */
+extern r_status_t r_video_offscreen_set_mode(r_state_t *rs, unsigned int width, unsigned int height);
+extern void r_video_offscreen_end(r_state_t *rs);
+
+extern void *r_video_offscreen_get_proc_address(const char *name);
+
+#endif
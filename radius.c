@@ -32,9 +32,10 @@ THE SOFTWARE.
 #include "r_event.h"
 #include "r_string.h"
 #include "r_platform.h"
+#include "r_replay.h"
 #include "radius.h"
 
-int radius_execute_application(const char *argv0, const char *application_name, const char *data_dir_override)
+static int radius_execute_application_internal(const char *argv0, const char *application_name, const char *data_dir_override, r_boolean_t headless, r_boolean_t offscreen, r_boolean_t capture, unsigned int frame_limit, const char *replay_path, r_replay_mode_t replay_mode)
 {
     r_status_t status = (application_name != NULL) ? R_SUCCESS : R_F_INVALID_POINTER;
 
@@ -44,6 +45,14 @@ int radius_execute_application(const char *argv0, const char *application_name,
         r_state_t *rs = &radius_state;
         r_status_t status = r_state_init(rs, argv0);
 
+        if (R_SUCCEEDED(status))
+        {
+            rs->headless = headless;
+            rs->headless_frame_limit = frame_limit;
+            rs->video_offscreen = offscreen;
+            rs->headless_capture = capture;
+        }
+
         if (R_SUCCEEDED(status))
         {
             /* Initialize file system first because it will setup stdout/stderr as necessary */
@@ -87,27 +96,36 @@ int radius_execute_application(const char *argv0, const char *application_name,
 
                                     if (R_SUCCEEDED(status))
                                     {
-                                        lua_State *ls = rs->script_state;
-
-                                        lua_pushliteral(ls, "require");
-                                        lua_rawget(ls, LUA_GLOBALSINDEX);
-                                        lua_pushstring(ls, script_path);
-                                        status = (lua_pcall(ls, 1, 0, 0) == 0) ? R_SUCCESS : RS_F_INVALID_ARGUMENT;
+                                        /* Start recording or playback before any scripts run */
+                                        if (replay_path != NULL)
+                                        {
+                                            status = r_replay_start(rs, replay_path, replay_mode);
+                                        }
 
                                         if (R_SUCCEEDED(status))
                                         {
-                                            status = R_SCRIPT_SET_ERROR_CONTEXT(rs, l_panic);
+                                            lua_State *ls = rs->script_state;
+
+                                            lua_pushliteral(ls, "require");
+                                            lua_rawget(ls, LUA_GLOBALSINDEX);
+                                            lua_pushstring(ls, script_path);
+                                            status = (lua_pcall(ls, 1, 0, 0) == 0) ? R_SUCCESS : RS_F_INVALID_ARGUMENT;
 
                                             if (R_SUCCEEDED(status))
                                             {
-                                                /* Main event loop */
-                                                r_event_loop(rs);
+                                                status = R_SCRIPT_SET_ERROR_CONTEXT(rs, l_panic);
+
+                                                if (R_SUCCEEDED(status))
+                                                {
+                                                    /* Main event loop */
+                                                    r_event_loop(rs);
+                                                }
+                                            }
+                                            else
+                                            {
+                                                r_log_error(rs, lua_tostring(ls, -1));
+                                                lua_pop(ls, 1);
                                             }
-                                        }
-                                        else
-                                        {
-                                            r_log_error(rs, lua_tostring(ls, -1));
-                                            lua_pop(ls, 1);
                                         }
 
                                         r_event_end(rs);
@@ -166,3 +184,32 @@ int radius_execute_application(const char *argv0, const char *application_name,
     return (int)status;
 }
 
+int radius_execute_application(const char *argv0, const char *application_name, const char *data_dir_override)
+{
+    return radius_execute_application_internal(argv0, application_name, data_dir_override, R_FALSE, R_FALSE, R_FALSE, 0, NULL, R_REPLAY_MODE_RECORD);
+}
+
+int radius_execute_headless_application(const char *argv0, const char *application_name, const char *data_dir_override, unsigned int frame_limit)
+{
+    return radius_execute_application_internal(argv0, application_name, data_dir_override, R_TRUE, R_FALSE, R_FALSE, frame_limit, NULL, R_REPLAY_MODE_RECORD);
+}
+
+int radius_execute_offscreen_application(const char *argv0, const char *application_name, const char *data_dir_override, unsigned int frame_limit)
+{
+    return radius_execute_application_internal(argv0, application_name, data_dir_override, R_TRUE, R_TRUE, R_FALSE, frame_limit, NULL, R_REPLAY_MODE_RECORD);
+}
+
+int radius_capture_offscreen_application(const char *argv0, const char *application_name, const char *data_dir_override, unsigned int frame_limit)
+{
+    return radius_execute_application_internal(argv0, application_name, data_dir_override, R_TRUE, R_TRUE, R_TRUE, frame_limit, NULL, R_REPLAY_MODE_RECORD);
+}
+
+int radius_record_application(const char *argv0, const char *application_name, const char *data_dir_override, const char *replay_path)
+{
+    return radius_execute_application_internal(argv0, application_name, data_dir_override, R_FALSE, R_FALSE, R_FALSE, 0, replay_path, R_REPLAY_MODE_RECORD);
+}
+
+int radius_replay_application(const char *argv0, const char *application_name, const char *data_dir_override, const char *replay_path)
+{
+    return radius_execute_application_internal(argv0, application_name, data_dir_override, R_FALSE, R_FALSE, R_FALSE, 0, replay_path, R_REPLAY_MODE_PLAY);
+}
@@ -28,4 +28,21 @@ THE SOFTWARE.
 
 extern int radius_execute_application(const char *argv0, const char *application_name, const char *data_dir_override);
 
+/* Runs the application without a window, audio device, or input, updating layers on a simulated clock as fast as
+ * possible until the layer stack is empty or (if frame_limit is non-zero) the given number of frames have run */
+extern int radius_execute_headless_application(const char *argv0, const char *application_name, const char *data_dir_override, unsigned int frame_limit);
+
+/* Runs headless as above, but also draws every frame into an offscreen framebuffer using a software OpenGL
+ * implementation (so rendering can be benchmarked and captured without a display; requires "--with-osmesa") */
+extern int radius_execute_offscreen_application(const char *argv0, const char *application_name, const char *data_dir_override, unsigned int frame_limit);
+
+/* Runs offscreen as above while capturing every drawn frame to a new capture file in the user directory (timestamps
+ * follow the simulated clock, so captures of the same run are reproducible) */
+extern int radius_capture_offscreen_application(const char *argv0, const char *application_name, const char *data_dir_override, unsigned int frame_limit);
+
+/* Runs the application while recording its input (events, clock and mouse samples, and random seed) to a file in the
+ * user directory, or replays such a recording as fast as possible (exiting once the recording has been replayed) */
+extern int radius_record_application(const char *argv0, const char *application_name, const char *data_dir_override, const char *replay_path);
+extern int radius_replay_application(const char *argv0, const char *application_name, const char *data_dir_override, const char *replay_path);
+
 #endif